@@ -11,15 +11,42 @@
 #include <system/core.hpp>
 #include <system/communication.hpp>
 #include <system/adc.hpp>
+#include <system/timer.hpp>
+#include <system/scheduler.hpp>
+#include <system/profiler.hpp>
+#include <system/control_rate.hpp>
+#include <system/clock_sync.hpp>
+#include <system/idle.hpp>
+#include <system/memory.hpp>
+#include <system/ram_budget.hpp>
+#include <system/trace.hpp>
 #include <external/i2c_sensor.hpp>
 
-/* this is called once TCNT0 = OCR0A = 249 *
- * resulting in a 1 ms cycle time, 1kHz    */
-volatile bool current_state = false;
+/* single instances of the system services, declared in their headers */
+supreme::timing::loop_timing    supreme::timing::loop;
+supreme::clock_sync::controller supreme::clock_sync::clock;
+supreme::trace::trace_recorder  supreme::trace::recorder;
+#if SUPREME_PROFILING
+volatile supreme::profile::section_stats supreme::profile::stats[supreme::profile::num_sections];
+#endif
+
+/* this is called once TCNT0 = OCR0A,     *
+ * resulting in the control rate, see      *
+ * system/control_rate.hpp (default 1kHz)  */
+volatile uint8_t control_ticks = 0;
+uint16_t clock_us = 0;
 ISR (TIMER0_COMPA_vect)
 {
-	current_state = !current_state;
-	xpcc::Clock::increment();
+	OCR0A = supreme::clock_sync::clock.next_compare(); // length of the next cycle
+	++control_ticks;
+	supreme::timing::loop.tick();
+
+	/* xpcc clock counts milliseconds */
+	clock_us += supreme::control_rate::us_per_cycle;
+	if (clock_us >= 1000) {
+		clock_us -= 1000;
+		xpcc::Clock::increment();
+	}
 }
 
 
@@ -28,42 +55,78 @@ int main()
 	Board::initialize();
 	supreme::adc::init();
 	supreme::adc::restart();
+	supreme::timer::init();
+	supreme::idle::init();
 
 	typedef supreme::sensorimotor_core<supreme::motordriver_t> core_t;
 	typedef supreme::ExternalSensor                            exts_t;
 	core_t core;
 	exts_t exts;
 
-	/* Design of the 1kHz main loop:
+	/* Design of the main loop (1kHz default):
 	 * 16Mhz clock, prescaler 64 -> 16.000.000 / 64 = 250.000 increments per second
 	 * diveded by 1000 -> 250 increments per ms
-	 * hence, timer compare register to 250-1 -> ISR inc ms counter -> 1kHz loop
+	 * hence, timer compare register to 250-1 -> ISR inc tick counter -> 1kHz loop
+	 * other rates: compare register to 250.000 / rate - 1
 	 *
 	 * configure timer 0:
 	 */
 	TCCR0A = (1<<WGM01);             // CTC mode
 	TCCR0B = (1<<CS01) | (1<<CS00);  // set prescaler to 64
-	OCR0A = 249;                     // set timer compare register to 250-1
+	OCR0A = supreme::control_rate::compare; // set timer compare register to 250-1 (1kHz)
 	TIMSK0 = (1<<OCIE0A);            // enable compare interrupt
 
 	unsigned long cycles = 0;
 
-	supreme::communication_ctrl<core_t, exts_t> com(core, exts);
+	typedef supreme::communication_ctrl<core_t, exts_t>       com_t;
+	com_t com(core, exts);
+
+	static_assert(sizeof(core_t) <= supreme::ram_budget::core         , "Core exceeds its RAM budget.");
+	static_assert(sizeof(com_t)  <= supreme::ram_budget::communication, "Communication exceeds its RAM budget.");
+	static_assert(sizeof(exts_t) <= supreme::ram_budget::ext_sensor   , "External sensor exceeds its RAM budget.");
+	static_assert(sizeof(supreme::trace::recorder) <= supreme::ram_budget::trace, "Trace recorder exceeds its RAM budget.");
+	static_assert(sizeof(core_t) + sizeof(com_t) + sizeof(exts_t) + sizeof(supreme::trace::recorder)
+	              + supreme::ram_budget::stack_reserve <= supreme::ram_budget::ram_size, "Subsystems leave no RAM for the stack.");
+	supreme::scheduler sched;
+
+	using namespace supreme::schedule;
+	namespace profile = supreme::profile;
 
-	bool previous_state = false;
 	core.init_sensors();
 	while(1) /* main loop */
 	{
-		com.step();
-		if (current_state != previous_state) {
+		const uint8_t tick = control_ticks;
+		sched.update(tick);
+
+		if (sched.begin(control)) {
 			led::red::set();   // red led on, begin of cycle
-			core.step();
+			{
+				profile::scope p(profile::control);
+				core.step();
+			}
+			supreme::trace::recorder.record(core);
 			supreme::adc::restart();
 			++cycles;
 			led::red::reset(); // red led off, end of cycle
-			previous_state = current_state;
-		} else
-			exts.step();
+			sched.end(control);
+		}
+		if (sched.begin(health)) {
+			core.health_step();
+			sched.end(health);
+		}
+		if (sched.begin(background)) {
+			{
+				profile::scope p(profile::communication);
+				com.step();
+			}
+			{
+				profile::scope p(profile::ext_sensor);
+				exts.step();
+			}
+			sched.end(background);
+		}
+		if (com.is_idle() and supreme::idle::sleep(control_ticks, tick))
+			supreme::timing::loop.woken(control_ticks != tick);
 	}
 	return 0;
 }
@@ -12,6 +12,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <xpcc/architecture/platform.hpp>
+#include <system/profiler.hpp>
 
 /*
 	+-------+-------+------------------------------------------+
@@ -90,6 +91,7 @@ namespace adc {
 
 ISR(ADC_vect)
 {
+	profile::scope p(profile::adc_isr);
 	adc::result[adc::channel] = ADC;         // read result (10 bit)
 	adc::channel = adc::next[adc::channel];  // select next channel
 	adc::set_channel(adc::channel);          // multiplex adc
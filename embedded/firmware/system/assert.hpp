@@ -13,7 +13,7 @@
 
 namespace supreme {
 
-void blink(uint8_t code) {
+inline void blink(uint8_t code) {
 	for (uint8_t i = 0; i < 8; ++i)
 	{
 		if ((code & (0x1 << i)) == 0)
@@ -34,7 +34,7 @@ void blink(uint8_t code) {
 }
 
 
-void assert(bool condition, uint8_t code = 0) {
+inline void assert(bool condition, uint8_t code = 0) {
 	if (condition) return;
 	led::red::reset();
 	led::yellow::reset();
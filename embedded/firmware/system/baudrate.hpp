@@ -0,0 +1,43 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_BAUDRATE_HPP
+#define SUPREME_BAUDRATE_HPP
+
+#include <avr/io.h>
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Runtime selection of the bus baud rate.
+
+	Board::initialize() sets up Uart0 with 1 Mbaud, this overrides the
+	baud rate register afterwards. Double speed mode (U2X0) is used:
+	16MHz / (8 * (UBRR0 + 1)) -> UBRR0 = 1: 1 Mbaud, UBRR0 = 0: 2 Mbaud,
+	both without error. The LTC2850 transceiver is rated for 20 Mbit/s.
+*/
+
+namespace supreme {
+namespace uart {
+
+	enum baudrate_t {
+		baud_1M = 0, /* default */
+		baud_2M = 1,
+		num_baudrates
+	};
+
+	inline void set_baudrate(uint8_t code) {
+		Uart0::flushWriteBuffer(); // do not cut off pending bytes
+		UCSR0A |= (1<<U2X0);
+		UBRR0H = 0;
+		UBRR0L = (code == baud_2M) ? 0 : 1;
+	}
+
+} /* namespace uart */
+} /* namespace supreme */
+
+#endif /* SUPREME_BAUDRATE_HPP */
@@ -0,0 +1,123 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_CLOCK_SYNC_HPP
+#define SUPREME_CLOCK_SYNC_HPP
+
+#include <avr/io.h>
+#include <xpcc/architecture/platform.hpp>
+#include <system/control_rate.hpp>
+
+/*
+	Alignment of the control cycle to the broadcast sync frame.
+
+	When a sync frame was received, timer 0 tells how far the control
+	tick is off (phase error): TCNT0 counts the increments (4us) since the
+	last tick. Motors are aligned, when their ticks coincide with the end
+	of the sync frame. The error is not corrected at once, but slewed by
+	lengthening or shortening the following cycles by at most 1/16 of a
+	cycle (lengthening is limited by the 8 bit compare register), which
+	keeps the control period steady.
+
+	Optionally, the phase error remaining at the next sync frame is used
+	to trim the cycle length by a fraction of an increment (frequency
+	trim), applied by adding an increment every n-th cycle.
+
+	The phase is taken when the main loop reads the final byte of the sync
+	frame, hence the accuracy is limited by the main loop latency.
+*/
+
+namespace supreme {
+namespace clock_sync {
+
+	enum mode_t {
+		off       = 0,
+		phase     = 1, /* default */
+		frequency = 2, /* phase and frequency */
+	};
+
+	const uint8_t period    = control_rate::compare + 1;  /* increments per cycle */
+	const uint8_t us_per_increment = 4;
+	const int16_t max_slew  = period / 16;
+	const int16_t max_trim  = 2 * 256; /* 1/256 increments per cycle */
+	const int16_t max_room  = 255 - control_rate::compare - 2; /* headroom for trim */
+	const int16_t max_step  = (max_room < max_slew) ? max_room : max_slew;
+
+	static_assert(max_room > 0, "No headroom for lengthening the control cycle.");
+
+	class controller {
+		uint8_t  mode = phase;
+		int16_t  slew = 0;       /* increments left to add (+) or remove (-) */
+		int16_t  offset = 0;     /* phase error at last sync, increments */
+		int16_t  trim_x256 = 0;  /* cycle length trim */
+		int16_t  trim_acc = 0;
+		uint16_t last_tick = 0;
+		bool     synced = false;
+
+	public:
+		/* sync frame received, current phase and tick counter */
+		void on_sync(uint8_t phase_increments, uint16_t tick)
+		{
+			int16_t e = phase_increments;
+			if (e >= period / 2) e -= period; /* tick is due, cycle is late */
+
+			const uint8_t sreg = SREG;
+			cli(); /* slew is used by the isr */
+			offset = e;
+			if (mode == frequency and synced) {
+				/* drift since last sync, without the part not yet slewed */
+				const int16_t drift = e - slew;
+				const uint16_t n = tick - last_tick;
+				if (n > 0 and n < 0x8000) {
+					trim_x256 += ((int32_t) drift * 256 / (int16_t) n) / 2;
+					if (trim_x256 >  max_trim) trim_x256 =  max_trim;
+					if (trim_x256 < -max_trim) trim_x256 = -max_trim;
+				}
+			}
+			slew = (mode != off) ? e : 0;
+			SREG = sreg;
+
+			last_tick = tick;
+			synced = true;
+		}
+
+		/* called by the control tick isr, returns the compare value of the next cycle */
+		uint8_t next_compare(void)
+		{
+			int16_t step = slew;
+			if (step >  max_step) step =  max_step;
+			if (step < -max_slew) step = -max_slew;
+			slew -= step;
+
+			trim_acc += trim_x256;
+			const int16_t frac = trim_acc / 256;
+			trim_acc -= frac * 256;
+
+			return control_rate::compare + step + frac;
+		}
+
+		void set_mode(uint8_t m) {
+			mode = (m <= frequency) ? m : (uint8_t) phase;
+			if (mode != frequency) trim_x256 = 0;
+			synced = false;
+		}
+
+		uint8_t get_mode     (void) const { return mode; }
+		int16_t get_offset_us(void) const { return offset * us_per_increment; }
+		int16_t get_trim     (void) const { return trim_x256; }
+	};
+
+	/* phase of the control cycle, timer 0 is reset on each tick */
+	inline uint8_t get_phase(void) { return TCNT0; }
+
+	extern controller clock; /* defined in main.cpp */
+
+} /* namespace clock_sync */
+} /* namespace supreme */
+
+#endif /* SUPREME_CLOCK_SYNC_HPP */
@@ -13,6 +13,16 @@
 #include <avr/eeprom.h>
 #include <system/assert.hpp>
 #include <system/sendbuffer.hpp>
+#include <system/timer.hpp>
+#include <system/registers.hpp>
+#include <system/baudrate.hpp>
+#include <system/status.hpp>
+#include <system/loop_timing.hpp>
+#include <system/profiler.hpp>
+#include <system/control_rate.hpp>
+#include <system/clock_sync.hpp>
+#include <system/memory.hpp>
+#include <system/trace.hpp>
 
 /*
 TODO: create new scheme for command processing:
@@ -29,11 +39,87 @@ TODO: create new scheme for command processing:
 			- timeout in byte stream
 
 	consider having a class for each command, derived from a (virtual) base class
-
-	TODO: clear recv buffer after timeout
 */
 namespace supreme {
 
+/* bus diagnostics, sent in this order on diagnostics request */
+struct diagnostics_t {
+	uint16_t checksum_errors  = 0;
+	uint16_t unknown_commands = 0;
+	uint16_t timeouts         = 0; /* messages cut off */
+	uint16_t frames_eaten     = 0; /* messages for other motors */
+	uint16_t rx_errors        = 0; /* uart data overrun or frame error */
+	uint16_t responses_sent   = 0;
+
+	static const uint8_t num_counters = 6;
+};
+
+/* saturating */
+inline void count(uint16_t& counter) { if (counter < 0xffff) ++counter; }
+
+namespace defaults {
+	const uint8_t byte_time_us  = 10; /* 8N1 at 1Mbaud */
+	const uint8_t slot_guard_us = 40; /* bus turnaround and main loop latency */
+	const uint8_t byte_timeout_us = 100; /* max. gap between bytes of a message */
+	const uint8_t stream_period_max = 60; /* ms, keeps deadlines within timer range */
+	const uint8_t stream_watchcat = 100; /* max. number of frames streamed without sync */
+	const uint8_t max_batch_len = 24; /* max. bytes of sub-commands per batch */
+	const uint8_t baud_fallback = 10; /* x 50ms without valid frame after switching */
+	const uint8_t max_groups = 4; /* group memberships per motor */
+	const uint8_t max_trace_chunk = 32; /* max. bytes per trace read */
+}
+
+/* protocol version and optional features, reported on capabilities request */
+namespace capabilities {
+	const uint8_t version_major = 1;
+	const uint8_t version_minor = 1;
+
+	enum feature_t {
+		crc8_check    = 0x0001,
+		sync_write    = 0x0002,
+		bulk_read     = 0x0004,
+		control_table = 0x0008,
+		telemetry     = 0x0010, /* selectable data response fields */
+		streaming     = 0x0020,
+		batch         = 0x0040,
+		baudrate_2M   = 0x0080,
+		groups        = 0x0100,
+		timestamps    = 0x0200,
+		diagnostics   = 0x0400,
+		profiling     = 0x0800, /* compile-time option */
+		trace         = 0x1000,
+		identification = 0x2000,
+	};
+
+	const uint16_t features = crc8_check | sync_write | bulk_read | control_table
+	                        | telemetry | streaming | batch | baudrate_2M | groups
+	                        | timestamps | diagnostics | trace | identification
+	                        | (SUPREME_PROFILING ? profiling : 0);
+}
+
+/* selectable fields of the data response, sent in this order */
+namespace telemetry {
+	enum field_t {
+		position         = 0x01,
+		current          = 0x02,
+		velocity         = 0x04,
+		voltage_supply   = 0x08,
+		temperature      = 0x10,
+		voltage_back_emf = 0x20,
+		status           = 0x40, /* status byte, fault byte */
+		timestamp        = 0x80, /* control cycle of the adc scan */
+	};
+
+	const uint8_t all    = 0xFF;
+	const uint8_t legacy = 0x1F; /* fields of protocol version 1.0, response 0x80 */
+
+	inline uint8_t num_words(uint8_t mask) {
+		uint8_t n = 0;
+		for (; mask; mask >>= 1) n += mask & 0x1;
+		return n;
+	}
+}
+
 template <typename CoreType, typename ExternalSensorType>
 class communication_ctrl {
 public:
@@ -50,6 +136,21 @@ public:
 		set_pwm_limit,   /* no response */
 		ext_sensor_request,
 		ext_sensor_request_resp,
+		set_voltage_all, /* broadcast, no response */
+		data_requested_all, /* broadcast, responded in time slots */
+		read_registers,
+		read_registers_resp,
+		write_registers, /* no response */
+		sync_frame,      /* broadcast, no response */
+		batch,
+		batch_response,
+		set_baudrate_all, /* broadcast, no response */
+		capabilities_request,
+		capabilities_response,
+		diagnostics_request,
+		diagnostics_response,
+		read_trace,
+		read_trace_resp,
 	};
 
 	enum command_state_t {
@@ -62,33 +163,76 @@ public:
 		pending   = 6,
 		finished  = 7,
 		error     = 8,
+		delaying  = 9,
 	};
 
+
 private:
 	CoreType&                    ux;
 	ExternalSensorType&          exts;
 	uint8_t                      recv_buffer = 0;
 	uint8_t                      recv_checksum = 0;
-	sendbuffer<16>               send;
+	frame_check_t                recv_mode = additive_checksum;
+	sendbuffer<40>               send;
 
 	uint8_t                      motor_id = 127; // set to default
+	uint8_t                      groups[defaults::max_groups]; /* group addresses, 0: none */
+	bool                         group_addressed = false;
+	uint8_t                      telemetry_mask = telemetry::legacy;
 	uint8_t                      target_id = 127;
 
 	/* motor related */
 	bool                         target_dir = false;
 	uint8_t                      target_pwm = 0;
 	uint8_t                      target_pwm_max = 0;
+	bool                         target_selected = false; /* own entry found in broadcast */
+	bool                         entry_selected = false;
+	uint8_t                      slot_position = 0;
+	uint8_t                      slot_size = 0;      /* bytes, 0: own data response */
+	uint16_t                     slot_start = 0;
+	uint16_t                     slot_delay = 0;
+
+	/* streaming */
+	uint8_t                      stream_period = 0; /* ms, 0: off */
+	uint8_t                      stream_slot = 0;
+	uint8_t                      stream_count = defaults::stream_watchcat;
+	uint16_t                     stream_next = 0;
+
+	/* control table access */
+	uint8_t                      reg_addr = 0;
+	uint8_t                      reg_len = 0;
+	uint8_t                      payload[defaults::max_batch_len]; /* register data or sub-commands */
+
+	/* trace download */
+	uint16_t                     trace_offset = 0;
+
+	/* batched commands */
+	uint8_t                      batch_len = 0;
+	bool                         batched = false;
+
+	/* baud rate switching */
+	uint8_t                      baudrate = uart::baud_1M;
+	uint8_t                      target_baud = 0;
+	bool                         baud_persist = false;
+	uint8_t                      baud_probation = 0; /* > 0: not yet confirmed by a valid frame */
+	uint16_t                     baud_since = 0;
 
 	/* TODO struct? */
 	command_id_t                 cmd_id    = no_command;
 	command_state_t              cmd_state = syncing;
 	unsigned int                 cmd_bytes_received = 0;
+	unsigned int                 cmd_bytes_expected = 0;
 
 	bool                         led_state = false;
 	bool                         sync_state = false;
 
 	uint8_t                      num_bytes_eaten = 0;
 	uint16_t                     errors = 0;
+	diagnostics_t                diag;
+	bool                         diag_reset = false;
+	uint8_t                      com_faults = 0; /* latched until reported */
+	uint16_t                     last_byte_time = 0;
+	uint8_t                      sync_phase = 0; /* control cycle phase at the end of a sync frame */
 
 public:
 
@@ -97,7 +241,17 @@ public:
 	, exts(exts)
 	, send()
 	{
+		static_assert(defaults::max_batch_len >= reg::max_access_len, "Payload buffer too small.");
+		static_assert(reg::group_3 - reg::group_0 + 1 == defaults::max_groups, "Group registers mismatch.");
+		static_assert(5 + defaults::max_trace_chunk + 1 <= sendbuffer<40>::capacity(), "Trace chunk exceeds send buffer.");
+
 		read_id_from_EEPROM();
+		read_telemetry_mask_from_EEPROM();
+		read_baudrate_from_EEPROM();
+		read_watchcat_from_EEPROM();
+		for (uint8_t i = 0; i < defaults::max_groups; ++i)
+			read_group_from_EEPROM(i);
+		stream_slot = motor_id;
 
 		rs485::drive_enable::setOutput();
 		rs485::drive_enable::reset();
@@ -109,51 +263,211 @@ public:
 	// TODO move to eeprom/memory class
 	void read_id_from_EEPROM() {
 		eeprom_busy_wait();
-		uint8_t read_id = eeprom_read_byte((uint8_t*)23);
+		uint8_t read_id = eeprom_read_byte((uint8_t*)eeprom_address::motor_id);
 		if (read_id) /* MSB is set, check if this id was written before */
 			motor_id = read_id & 0x7F;
 	}
 
 	void write_id_to_EEPROM(uint8_t new_id) {
 		eeprom_busy_wait();
-		eeprom_write_byte((uint8_t*)23, (new_id | 0x80));
+		eeprom_write_byte((uint8_t*)eeprom_address::motor_id, (new_id | 0x80));
+	}
+
+	/* stored inverted, as all 8 bits are used and an empty mask is useless */
+	void read_telemetry_mask_from_EEPROM() {
+		eeprom_busy_wait();
+		uint8_t mask = ~eeprom_read_byte((uint8_t*)eeprom_address::telemetry_mask);
+		telemetry_mask = (mask != 0) ? mask : telemetry::legacy;
+	}
+
+	void write_telemetry_mask_to_EEPROM(uint8_t mask) {
+		eeprom_busy_wait();
+		eeprom_write_byte((uint8_t*)eeprom_address::telemetry_mask, ~mask);
+	}
+
+	/* stored inverted, so erased cells select the defaults */
+	void read_watchcat_from_EEPROM() {
+		eeprom_busy_wait();
+		const uint8_t timeout = ~eeprom_read_byte((uint8_t*)eeprom_address::watchcat_timeout);
+		const uint8_t mode    = ~eeprom_read_byte((uint8_t*)eeprom_address::stop_mode);
+		ux.set_watchcat_timeout(timeout); /* 0: default */
+		ux.set_stop_mode(mode);
+	}
+
+	void write_watchcat_to_EEPROM(uint8_t* addr, uint8_t value) {
+		eeprom_busy_wait();
+		eeprom_write_byte(addr, ~value);
 	}
 
+	void read_group_from_EEPROM(uint8_t i) {
+		eeprom_busy_wait();
+		uint8_t group = eeprom_read_byte((uint8_t*)eeprom_address::groups + i);
+		groups[i] = (group >= 0x80 and group < 0xFF) ? group : 0;
+	}
+
+	void write_group_to_EEPROM(uint8_t i, uint8_t group) {
+		eeprom_busy_wait();
+		eeprom_write_byte((uint8_t*)eeprom_address::groups + i, group);
+	}
+
+	/* group address 0xFF addresses all motors */
+	bool is_group_member(uint8_t group) const {
+		if (group == 0xFF) return true;
+		for (uint8_t i = 0; i < defaults::max_groups; ++i)
+			if (groups[i] == group) return true;
+		return false;
+	}
+
+	void read_baudrate_from_EEPROM() {
+		eeprom_busy_wait();
+		uint8_t code = eeprom_read_byte((uint8_t*)eeprom_address::baudrate);
+		if (code != uart::baud_1M and code < uart::num_baudrates)
+			switch_baudrate(code, false); /* falls back unless confirmed */
+	}
+
+	void write_baudrate_to_EEPROM(uint8_t code) {
+		eeprom_busy_wait();
+		eeprom_write_byte((uint8_t*)eeprom_address::baudrate, code);
+	}
+
+	/* the new rate must be confirmed by a valid frame, see check_baudrate() */
+	void switch_baudrate(uint8_t code, bool persist) {
+		uart::set_baudrate(code);
+		baudrate = code;
+		baud_persist = persist;
+		baud_probation = (code != uart::baud_1M) ? 1 : 0;
+		baud_since = timer::now();
+		if (persist and code == uart::baud_1M)
+			write_baudrate_to_EEPROM(code);
+	}
+
+	/* called for every valid frame addressed to this motor */
+	void confirm_baudrate(void) {
+		if (baud_probation == 0) return;
+		baud_probation = 0;
+		if (baud_persist)
+			write_baudrate_to_EEPROM(baudrate);
+	}
+
+	/* revert to 1 Mbaud, if no valid frame was received at the new rate */
+	void check_baudrate(void) {
+		if (baud_probation == 0) return;
+		if (not timer::elapsed(baud_since, timer::us_to_ticks(50000))) return;
+		baud_since += timer::us_to_ticks(50000);
+		if (++baud_probation <= defaults::baud_fallback) return;
+		switch_baudrate(uart::baud_1M, false);
+	}
+
+	uint8_t byte_time_us() const { return defaults::byte_time_us >> baudrate; }
+
+	/* incl. sync bytes and checksum */
+	uint8_t data_response_size() const { return 5 + 2 * telemetry::num_words(telemetry_mask); }
+
 	inline
 	bool byte_received(void) {
 		bool result = Uart0::read(recv_buffer);
-		if (result)
-			recv_checksum += recv_buffer;
+		if (result) {
+			recv_checksum = frame_check::update(recv_mode, recv_checksum, recv_buffer);
+			last_byte_time = timer::now();
+		}
 		return result;
 	}
 
+	/* drop a message which was cut off and resynchronize,
+	   return code true means continue processing */
+	bool timed_out(void) {
+		if (not timer::elapsed(last_byte_time, timer::us_to_ticks(defaults::byte_timeout_us)))
+			return false;
+		count(diag.timeouts);
+		com_faults |= fault::com_timeout;
+		sync_state = false;
+		cmd_state = finished;
+		return true;
+	}
+
+	/* status byte and fault byte, reading clears latched faults */
+	uint16_t get_status_word(void)
+	{
+		uint8_t s = 0;
+		if (ux.is_enabled())     s |= status::enabled;
+		if (ux.get_target_dir()) s |= status::direction;
+		if (is_streaming())      s |= status::streaming;
+		if (baud_probation)      s |= status::baud_unconfirmed;
+		if (ux.is_stopping())    s |= status::stopping;
+		if (ux.is_identifying()) s |= status::identifying;
+
+		const uint8_t f = ux.get_faults() | com_faults;
+		com_faults = 0;
+		return (s << 8) | f;
+	}
+
 	command_state_t get_state()    const { return cmd_state; }
 	uint8_t         get_motor_id() const { return motor_id; }
+	uint8_t         get_telemetry_mask() const { return telemetry_mask; }
+	bool            is_streaming() const { return stream_count < defaults::stream_watchcat; }
 	uint16_t        get_errors()   const { return errors; }
+	uint16_t        get_timeouts() const { return diag.timeouts; }
+	diagnostics_t const& get_diagnostics() const { return diag; }
+	uint8_t         get_baudrate() const { return baudrate; }
+
+	/* nothing to do until the next byte, hence the cpu may sleep */
+	bool is_idle() const { return cmd_state == syncing and not sync_state and not is_streaming(); }
 
 	command_state_t waiting_for_id()
 	{
-		if (recv_buffer > 127) return error;
+		/* IDs above 127 are group addresses, the motor does not respond */
+		const bool group = recv_buffer > 127;
+		const bool selected = group ? is_group_member(recv_buffer) : (motor_id == recv_buffer);
+		group_addressed = group and selected;
+
 		switch(cmd_id)
 		{
 			/* single byte commands */
 			case data_requested:
 			case toggle_led:
 			case ping:
-				return (motor_id == recv_buffer) ? verifying : eating;
+			case capabilities_request:
+				return selected ? verifying : eating;
 
 			/* multi-byte commands */
 			case set_voltage:
-			case set_id:
 			case set_pwm_limit:
 			case ext_sensor_request:
+			case read_registers:
+			case write_registers:
+			case batch:
+			case diagnostics_request:
+			case read_trace:
+				return selected ? reading : eating;
+
+			case set_id: /* never group addressed */
 				return (motor_id == recv_buffer) ? reading : eating;
 
+			default: break;
+		}
+
+		if (group) return error;
+		switch(cmd_id)
+		{
+			/* broadcast commands, the id field holds the number of entries */
+			case set_voltage_all:
+				cmd_bytes_expected = 2 * recv_buffer;
+				return (cmd_bytes_expected > 0) ? reading : verifying;
+
+			case data_requested_all: /* slot size, followed by list of ids */
+				cmd_bytes_expected = 1 + recv_buffer;
+				return reading;
+
 			/* responses */
 			case ping_response:           return eating;
 			case set_id_response:         return eating;
 			case data_requested_response: return eating;
 			case ext_sensor_request_resp: return eating;
+			case read_registers_resp:     return eating;
+			case batch_response:          return eating;
+			case capabilities_response:   return eating;
+			case diagnostics_response:    return eating;
+			case read_trace_resp:         return eating;
 
 			default: /* unknown command */ break;
 		}
@@ -161,18 +475,227 @@ public:
 		return finished;
 	}
 
+	uint16_t read_register(uint8_t addr)
+	{
+		if (addr >= reg::profile and addr < reg::profile + reg::profile_len) {
+			const uint8_t i = (addr - reg::profile) / 2;
+			return profile::get_word(static_cast<profile::section_t>(i / 4), i % 4);
+		}
+
+		switch(addr)
+		{
+			case reg::motor_id        : return motor_id;
+			case reg::telemetry_mask  : return telemetry_mask;
+			case reg::stream_period   : return stream_period;
+			case reg::stream_slot     : return stream_slot;
+			case reg::baudrate        : return baudrate;
+			case reg::sync_mode       : return clock_sync::clock.get_mode();
+			case reg::ticks           : return ux.get_ticks();
+			case reg::group_0         : return groups[0];
+			case reg::group_1         : return groups[1];
+			case reg::group_2         : return groups[2];
+			case reg::group_3         : return groups[3];
+			case reg::sync_offset     : return clock_sync::clock.get_offset_us();
+			case reg::sync_trim       : return clock_sync::clock.get_trim();
+			case reg::watchcat_timeout: return ux.get_watchcat_timeout();
+			case reg::stop_mode       : return ux.get_stop_mode();
+			case reg::pwm_limit       : return ux.get_pwm_limit();
+			case reg::hold_gain       : return (uint8_t) ux.get_hold_gain();
+			case reg::position        : return ux.get_position();
+			case reg::current         : return ux.get_current();
+			case reg::velocity        : return ux.get_velocity();
+			case reg::voltage_back_emf: return ux.get_voltage_back_emf();
+			case reg::voltage_supply  : return ux.get_voltage_supply();
+			case reg::temperature     : return ux.get_temperature();
+			case reg::status          : return get_status_word();
+			case reg::exec_min        : return timing::loop.get_exec_min();
+			case reg::exec_max        : return timing::loop.get_exec_max();
+			case reg::exec_mean       : return timing::loop.get_exec_mean();
+			case reg::start_jitter    : return timing::loop.get_jitter();
+			case reg::missed_ticks    : return timing::loop.get_missed_ticks();
+			case reg::overruns_control:
+			case reg::overruns_health :
+			case reg::overruns_backgnd: return timing::loop.get_overruns((addr - reg::overruns_control) / 2);
+			case reg::hist_0          :
+			case reg::hist_1          :
+			case reg::hist_2          :
+			case reg::hist_3          :
+			case reg::hist_4          :
+			case reg::hist_5          :
+			case reg::hist_6          :
+			case reg::hist_7          : return timing::loop.get_histogram((addr - reg::hist_0) / 2);
+			case reg::wake_latency    : return timing::loop.get_wake_latency();
+			case reg::sleeps          : return timing::loop.get_sleeps();
+			case reg::ram_static      : return memory::static_size();
+			case reg::ram_unused      : return memory::unused();
+			case reg::stack_peak      : return memory::stack_peak();
+			case reg::size_core       : return sizeof(CoreType);
+			case reg::size_com        : return sizeof(*this);
+			case reg::size_ext_sensor : return sizeof(ExternalSensorType);
+			case reg::trace_state     : return trace::recorder.get_state();
+			case reg::trace_channels  : return trace::recorder.get_channels();
+			case reg::trace_divider   : return trace::recorder.get_divider();
+			case reg::trigger_mode    : return trace::recorder.get_trigger_mode();
+			case reg::trigger_channel : return trace::recorder.get_trigger_channel();
+			case reg::trigger_level   : return trace::recorder.get_level();
+			case reg::pre_trigger     : return trace::recorder.get_pre_trigger();
+			case reg::trace_samples   : return trace::recorder.get_samples();
+			case reg::trigger_pos     : return trace::recorder.get_trigger_pos();
+			case reg::trace_capacity  : return trace::recorder.get_capacity();
+			case reg::ident_state     : return ux.is_identifying();
+			case reg::ident_signal    : return ux.get_excitation().get_signal();
+			case reg::ident_amplitude : return ux.get_excitation().get_amplitude();
+			case reg::ident_bias      : return (uint8_t) ux.get_excitation().get_bias();
+			case reg::ident_length    : return ux.get_excitation().get_length();
+			case reg::prbs_seed       : return ux.get_excitation().get_seed();
+			case reg::prbs_hold       : return ux.get_excitation().get_hold();
+			case reg::chirp_f0        : return ux.get_excitation().get_f0();
+			case reg::chirp_f1        : return ux.get_excitation().get_f1();
+			default: break;
+		}
+		return 0;
+	}
+
+	void write_register(uint8_t addr, uint16_t value)
+	{
+		switch(addr)
+		{
+			case reg::motor_id: /* like set_id, never group addressed */
+				if (value < 128 and not group_addressed) {
+					write_id_to_EEPROM(value);
+					read_id_from_EEPROM();
+				}
+				break;
+			case reg::telemetry_mask:
+				write_telemetry_mask_to_EEPROM(value);
+				read_telemetry_mask_from_EEPROM();
+				break;
+			case reg::stream_period:
+				stream_period = (value < defaults::stream_period_max) ? value : defaults::stream_period_max;
+				if (stream_period == 0) stream_count = defaults::stream_watchcat; /* stop */
+				break;
+			case reg::stream_slot: stream_slot = value; break;
+			case reg::sync_mode: clock_sync::clock.set_mode(value); break;
+			case reg::ticks: ux.set_ticks(value); break; /* set epoch */
+			case reg::group_0:
+			case reg::group_1:
+			case reg::group_2:
+			case reg::group_3:
+				write_group_to_EEPROM(addr - reg::group_0, value);
+				read_group_from_EEPROM(addr - reg::group_0);
+				break;
+			case reg::pwm_limit: ux.set_pwm_limit(value); break;
+			case reg::hold_gain: ux.set_hold_gain(value); break;
+			case reg::watchcat_timeout:
+				write_watchcat_to_EEPROM((uint8_t*)eeprom_address::watchcat_timeout, value);
+				read_watchcat_from_EEPROM();
+				break;
+			case reg::stop_mode:
+				write_watchcat_to_EEPROM((uint8_t*)eeprom_address::stop_mode, value);
+				read_watchcat_from_EEPROM();
+				break;
+			case reg::trace_state    : trace::recorder.command(value);             break;
+			case reg::trace_channels : trace::recorder.set_channels(value);        break;
+			case reg::trace_divider  : trace::recorder.set_divider(value);         break;
+			case reg::trigger_mode   : trace::recorder.set_trigger_mode(value);    break;
+			case reg::trigger_channel: trace::recorder.set_trigger_channel(value); break;
+			case reg::trigger_level  : trace::recorder.set_level(value);           break;
+			case reg::pre_trigger    : trace::recorder.set_pre_trigger(value);     break;
+			case reg::ident_state:
+				if (value) start_identification();
+				else ux.stop_identification();
+				break;
+			case reg::ident_signal   : ux.get_excitation().set_signal(value);    break;
+			case reg::ident_amplitude: ux.get_excitation().set_amplitude(value); break;
+			case reg::ident_bias     : ux.get_excitation().set_bias(value);      break;
+			case reg::ident_length   : ux.get_excitation().set_length(value);    break;
+			case reg::prbs_seed      : ux.get_excitation().set_seed(value);      break;
+			case reg::prbs_hold      : ux.get_excitation().set_hold(value);      break;
+			case reg::chirp_f0       : ux.get_excitation().set_f0(value);        break;
+			case reg::chirp_f1       : ux.get_excitation().set_f1(value);        break;
+			default: break;
+		}
+	}
+
+	/* the trace records the run from its first cycle on, a run not
+	   fitting into the trace with the selected channels is not started */
+	void start_identification(void)
+	{
+		if (ux.get_excitation().get_length() > trace::recorder.get_capacity()) return;
+		trace::recorder.command(trace::arm);
+		trace::recorder.command(trace::trigger);
+		ux.start_identification();
+	}
+
+	/* each register is read once, unmapped bytes are read as zero */
+	void add_registers(uint8_t addr, uint8_t len)
+	{
+		const uint16_t end = addr + len;
+		uint16_t a = addr;
+
+		/* window starts with the low byte of a word */
+		if (a < end and a > 0 and reg::size(reg::attributes(a - 1)) == 2) {
+			send.add_byte(read_register(a - 1) & 0xff);
+			++a;
+		}
+		while (a < end) {
+			const uint8_t n = (a <= 0xff) ? reg::size(reg::attributes(a)) : 0;
+			if (n == 0) {
+				send.add_byte(0);
+				++a;
+				continue;
+			}
+			const uint16_t value = read_register(a);
+			if (n == 2) {
+				send.add_byte((value >> 8) & 0xff);
+				if (++a == end) break;
+			}
+			send.add_byte(value & 0xff);
+			++a;
+		}
+	}
+
+	/* only writable registers lying completely within the window are written */
+	void write_registers_from(const uint8_t* data)
+	{
+		uint8_t i = 0;
+		while (i < reg_len) {
+			const uint16_t a = reg_addr + i;
+			const uint8_t attr = (a <= 0xff) ? reg::attributes(a) : (uint8_t) reg::invalid;
+			const uint8_t n = reg::size(attr);
+			if (n == 0 or not reg::is_writable(attr) or i + n > reg_len) {
+				++i;
+				continue;
+			}
+			const uint16_t value = (n == 2) ? (data[i] << 8) | data[i+1] : data[i];
+			write_register(a, value);
+			i += n;
+		}
+	}
+
+	/* sub-responses of a batch omit the motor id */
+	void add_header(uint8_t response_id)
+	{
+		send.add_byte(response_id);
+		if (not batched) send.add_byte(motor_id);
+	}
+
 	void prepare_data_response(void)
 	{
-		send.add_byte(0x80); /* 1000.0000 */
-		send.add_byte(motor_id);
-		send.add_word(ux.get_position());
-		send.add_word(ux.get_current());
-		send.add_word(ux.get_velocity());
-		send.add_word(ux.get_voltage_supply());
-		send.add_word(ux.get_temperature());
-		//TODO: integrate voltage_back_emf again
+		if (group_addressed) return; /* not sent, keep latched faults */
+		if (telemetry_mask == telemetry::legacy)
+			add_header(0x80); /* 1000.0000 */
+		else /* 1001.nnnn, number of words */
+			add_header(0x90 | telemetry::num_words(telemetry_mask));
+		if (telemetry_mask & telemetry::position        ) send.add_word(ux.get_position());
+		if (telemetry_mask & telemetry::current         ) send.add_word(ux.get_current());
+		if (telemetry_mask & telemetry::velocity        ) send.add_word(ux.get_velocity());
+		if (telemetry_mask & telemetry::voltage_supply  ) send.add_word(ux.get_voltage_supply());
+		if (telemetry_mask & telemetry::temperature     ) send.add_word(ux.get_temperature());
+		if (telemetry_mask & telemetry::voltage_back_emf) send.add_word(ux.get_voltage_back_emf());
+		if (telemetry_mask & telemetry::status          ) send.add_word(get_status_word());
+		if (telemetry_mask & telemetry::timestamp       ) send.add_word(ux.get_sample_tick());
 		//TODO: integrate state/context fields
-		//TODO: integrate error/status codes
 	}
 
 	command_state_t process_command()
@@ -204,8 +727,41 @@ public:
 				break;
 
 			case ping:
-				send.add_byte(0xE1); /* 1110.0001 */
-				send.add_byte(motor_id);
+				add_header(0xE1); /* 1110.0001 */
+				break;
+
+			case capabilities_request: /* length, followed by fields */
+				add_header(0x11); /* 0001.0001 */
+				send.add_byte(11);
+				send.add_byte(capabilities::version_major);
+				send.add_byte(capabilities::version_minor);
+				send.add_word(capabilities::features);
+				send.add_byte(defaults::max_batch_len);
+				send.add_byte(reg::max_access_len);
+				send.add_byte(send.capacity());
+				send.add_byte(defaults::stream_period_max);
+				send.add_byte(defaults::max_groups);
+				send.add_word(control_rate::hz);
+				break;
+
+			case diagnostics_request: /* length, counters, optionally reset */
+				add_header(0x21); /* 0010.0001 */
+				send.add_byte(2 * (diagnostics_t::num_counters + 2));
+				send.add_word(diag.checksum_errors);
+				send.add_word(diag.unknown_commands);
+				send.add_word(diag.timeouts);
+				send.add_word(diag.frames_eaten);
+				send.add_word(diag.rx_errors);
+				send.add_word(diag.responses_sent);
+				send.add_word(ux.get_watchcat_trips());
+				send.add_word(errors);
+				if (diag_reset) {
+					diag = diagnostics_t();
+					errors = 0;
+					ux.reset_watchcat_trips();
+					timing::loop.reset();
+					profile::reset();
+				}
 				break;
 
 			case set_id:
@@ -220,9 +776,53 @@ public:
 				/* no response needed */
 				break;
 
+			case sync_frame:
+				clock_sync::clock.on_sync(sync_phase, ux.get_ticks());
+				if (stream_period > 0) start_streaming();
+				/* broadcasts are never responded */
+				break;
+
+			case set_baudrate_all:
+				switch_baudrate(target_baud & 0x0F, target_baud & 0x80);
+				/* broadcasts are never responded */
+				break;
+
+			case set_voltage_all:
+				if (target_selected) {
+					ux.set_target_pwm(target_pwm);
+					ux.set_target_dir(target_dir);
+					ux.enable();
+				}
+				/* broadcasts are never responded */
+				break;
+
+			case data_requested_all:
+				if (not target_selected) break;
+				/* unlike data_requested, the motor is kept running */
+				schedule_slot();
+				return delaying;
+
+			case read_registers:
+				if (group_addressed) break; /* not sent, keep latched faults */
+				add_header(0x51); /* 0101.0001 */
+				send.add_byte(reg_len);
+				add_registers(reg_addr, reg_len);
+				break;
+
+			case read_trace: /* length, recorded bytes */
+				add_header(0x59); /* 0101.1001 */
+				send.add_byte(reg_len);
+				for (uint8_t i = 0; i < reg_len; ++i)
+					send.add_byte(trace::recorder.get_byte(trace_offset + i));
+				break;
+
+			case write_registers:
+				write_registers_from(payload);
+				/* no response needed */
+				break;
+
 			case ext_sensor_request:
-				send.add_byte(0x41); /* 0100.0001 */
-				send.add_byte(motor_id);
+				add_header(0x41); /* 0100.0001 */
 				{
 					auto const& s = exts.get_values();
 					send.add_word(s.x);
@@ -232,6 +832,9 @@ public:
 				exts.restart();
 				break;
 
+			case batch:
+				return process_batch();
+
 			default: /* unknown command */
 				assert(false, 2);
 				break;
@@ -242,6 +845,96 @@ public:
 	}
 
 
+	/* Sub-commands of a batch are regular requests without sync bytes,
+	   motor id and checksum, returns 0 if invalid or truncated. */
+	uint8_t sub_command_size(uint8_t i) const
+	{
+		const uint8_t remaining = batch_len - i;
+		uint16_t n = 0;
+		switch(payload[i])
+		{
+			case 0xC0: /* data_requested */
+			case 0xD0: /* toggle_led     */
+			case 0xE0: /* ping           */ n = 1; break;
+			case 0xB0: /* set_voltage    */
+			case 0xB1:
+			case 0xA0: /* set_pwm_limit  */
+			case 0x40: /* ext_sensor_req */ n = 2; break;
+			case 0x50: /* read_registers */
+				if (remaining >= 3 and payload[i+2] <= reg::max_access_len) n = 3;
+				break;
+			case 0x60: /* write_registers */
+				if (remaining >= 3 and payload[i+2] <= reg::max_access_len) n = 3 + payload[i+2];
+				break;
+			default: /* not allowed in batch */ break;
+		}
+		return (n <= remaining) ? n : 0;
+	}
+
+	/* sub-responses likewise omit sync bytes, motor id and checksum */
+	uint8_t sub_response_size(uint8_t i) const
+	{
+		switch(payload[i])
+		{
+			case 0xC0:
+			case 0xB0:
+			case 0xB1: return 1 + 2 * telemetry::num_words(telemetry_mask);
+			case 0xE0: return 1;
+			case 0x40: return 7;
+			case 0x50: return 2 + payload[i+2];
+			default: break;
+		}
+		return 0;
+	}
+
+	/* all sub-commands are checked before any is executed,
+	   the number of sub-commands is bounded by the batch length */
+	command_state_t process_batch()
+	{
+		uint16_t response_len = 0;
+		for (uint8_t i = 0, n = 0; i < batch_len; i += n) {
+			n = sub_command_size(i);
+			if (n == 0) return error;
+			response_len += sub_response_size(i);
+			/* sync bytes, response id, motor id, length, checksum */
+			if (5u + response_len + 1u > send.capacity()) return error;
+		}
+
+		send.add_byte(0x31); /* 0011.0001 */
+		send.add_byte(motor_id);
+		send.add_byte(response_len);
+
+		batched = true;
+		for (uint8_t i = 0; i < batch_len; i += sub_command_size(i)) {
+			const uint8_t op = payload[i];
+			switch(op)
+			{
+				case 0xC0: cmd_id = data_requested;     break;
+				case 0xD0: cmd_id = toggle_led;         break;
+				case 0xE0: cmd_id = ping;               break;
+				case 0xB0:
+				case 0xB1: cmd_id = set_voltage;
+				           target_dir = op & 0x1;
+				           target_pwm = payload[i+1];   break;
+				case 0xA0: cmd_id = set_pwm_limit;
+				           target_pwm_max = payload[i+1]; break;
+				case 0x40: cmd_id = ext_sensor_request; break;
+				case 0x50: cmd_id = read_registers;
+				           reg_addr = payload[i+1];
+				           reg_len  = payload[i+2];     break;
+				case 0x60: cmd_id = write_registers;
+				           reg_addr = payload[i+1];
+				           reg_len  = payload[i+2];
+				           write_registers_from(&payload[i+3]);
+				           continue;
+				default: assert(false, 6); break;
+			}
+			process_command();
+		}
+		batched = false;
+		return finished;
+	}
+
 	/* handle multi-byte commands */
 	command_state_t waiting_for_data()
 	{
@@ -266,6 +959,72 @@ public:
 				//ext_sensor_id = recv_buffer; TODO handle sensor id
 				return verifying;
 
+			case diagnostics_request: /* 0000.000R, R: reset counters */
+				diag_reset = recv_buffer & 0x1;
+				return verifying;
+
+			case set_voltage_all:
+				/* entries of (D|ID, PWM), pick out the own one */
+				if (cmd_bytes_received % 2 == 0) {
+					entry_selected = (recv_buffer & 0x7F) == motor_id;
+					if (entry_selected) target_dir = recv_buffer & 0x80;
+				}
+				else if (entry_selected) {
+					target_pwm = recv_buffer;
+					target_selected = true;
+				}
+				return (++cmd_bytes_received < cmd_bytes_expected) ? reading : verifying;
+
+			case read_registers: /* address, length */
+				if (cmd_bytes_received == 0)
+					reg_addr = recv_buffer;
+				else if (recv_buffer <= reg::max_access_len)
+					reg_len = recv_buffer;
+				else return error;
+				return (++cmd_bytes_received < 2) ? reading : verifying;
+
+			case read_trace: /* offset (msb first), length */
+				if (cmd_bytes_received == 0)
+					trace_offset = recv_buffer << 8;
+				else if (cmd_bytes_received == 1)
+					trace_offset |= recv_buffer;
+				else if (recv_buffer <= defaults::max_trace_chunk)
+					reg_len = recv_buffer;
+				else return error;
+				return (++cmd_bytes_received < 3) ? reading : verifying;
+
+			case write_registers: /* address, length, data */
+				if (cmd_bytes_received == 0)
+					reg_addr = recv_buffer;
+				else if (cmd_bytes_received == 1) {
+					if (recv_buffer > reg::max_access_len) return error;
+					reg_len = recv_buffer;
+				}
+				else payload[cmd_bytes_received - 2] = recv_buffer;
+				return (++cmd_bytes_received < 2u + reg_len) ? reading : verifying;
+
+			case set_baudrate_all: /* P000.rrrr, P: persist */
+				if ((recv_buffer & 0x0F) >= uart::num_baudrates) return error;
+				target_baud = recv_buffer;
+				return verifying;
+
+			case batch: /* length, sub-commands */
+				if (cmd_bytes_received == 0) {
+					if (recv_buffer == 0 or recv_buffer > defaults::max_batch_len) return error;
+					batch_len = recv_buffer;
+				}
+				else payload[cmd_bytes_received - 1] = recv_buffer;
+				return (++cmd_bytes_received < 1u + batch_len) ? reading : verifying;
+
+			case data_requested_all:
+				if (cmd_bytes_received == 0)
+					slot_size = recv_buffer;
+				else if (recv_buffer == motor_id and not target_selected) {
+					slot_position = cmd_bytes_received - 1;
+					target_selected = true;
+				}
+				return (++cmd_bytes_received < cmd_bytes_expected) ? reading : verifying;
+
 			default: /* unknown command */ break;
 		}
 		assert(false, 4);
@@ -280,6 +1039,7 @@ public:
 			case data_requested:
 			case toggle_led:
 			case ping:
+			case capabilities_request:
 			case ping_response:
 			case set_id_response:
 				assert(num_bytes_eaten == 1, 77);
@@ -289,13 +1049,33 @@ public:
 			case set_id:
 			case set_pwm_limit:
 			case ext_sensor_request:
+			case diagnostics_request:
 				return (num_bytes_eaten <  2) ? eating : finished;
 
 			case ext_sensor_request_resp:
 				return (num_bytes_eaten <  7) ? eating : finished;
 
+			case read_registers:
+				return (num_bytes_eaten <  3) ? eating : finished;
+
+			case read_trace:
+				return (num_bytes_eaten <  4) ? eating : finished;
+
+			case write_registers: /* address, length, data, checksum */
+				if (num_bytes_eaten == 2) cmd_bytes_expected = 3 + recv_buffer;
+				return (num_bytes_eaten < 2 or num_bytes_eaten < cmd_bytes_expected) ? eating : finished;
+
+			case read_registers_resp: /* length, data, checksum */
+			case batch:
+			case batch_response:
+			case capabilities_response:
+			case diagnostics_response:
+			case read_trace_resp:
+				if (num_bytes_eaten == 1) cmd_bytes_expected = 2 + recv_buffer;
+				return (num_bytes_eaten < cmd_bytes_expected) ? eating : finished;
+
 			case data_requested_response:
-				return (num_bytes_eaten < 11) ? eating : finished;
+				return (num_bytes_eaten < cmd_bytes_expected) ? eating : finished;
 
 			default: /* unknown command */ break;
 		}
@@ -303,29 +1083,94 @@ public:
 		return finished;
 	}
 
+	/* the n-th listed motor responds after n time slots,
+	   counted from the end of the request */
+	void schedule_slot(void)
+	{
+		const uint16_t slot_us = (slot_size ? slot_size : data_response_size())
+		                       * byte_time_us() + defaults::slot_guard_us;
+		const uint32_t delay = (uint32_t) slot_position * timer::us_to_ticks(slot_us);
+		slot_delay = (delay < 0xffff) ? delay : 0xffff;
+		slot_start = timer::now();
+	}
+
+	/* (re)align streaming to the sync frame, frames are sent
+	   in the motor's slot after the sync and every period thereafter */
+	void start_streaming(void)
+	{
+		slot_size = 0;
+		slot_position = stream_slot;
+		schedule_slot();
+		stream_next = slot_start + slot_delay;
+		stream_count = 0;
+	}
+
+	void stream(void)
+	{
+		if (not is_streaming()) return;
+		if (cmd_state != syncing or sync_state) return; /* do not interfere with receiving */
+		if (not timer::reached(stream_next)) return;
+
+		prepare_data_response();
+		if (send.flush()) count(diag.responses_sent);
+
+		const uint16_t period = stream_period * timer::us_to_ticks(1000);
+		do stream_next += period; /* skip periods missed */
+		while (timer::reached(stream_next));
+
+		++stream_count; /* stops streaming when host goes silent */
+	}
+
 	command_state_t verify_checksum()
 	{
-		return (recv_checksum == 0) ? pending : error;
+		if (recv_checksum == 0) return pending;
+		count(diag.checksum_errors);
+		return error;
 	}
 
 	command_state_t get_sync_bytes()
 	{
-		if (recv_buffer != 0xFF) {
-			sync_state = false;
-			return finished;
-		}
-
 		if (sync_state) {
 			sync_state = false;
-			return awaiting;
+			switch(recv_buffer)
+			{
+				case 0xFF: set_frame_check(additive_checksum); return awaiting;
+				case 0xFD: set_frame_check(crc8_checksum);     return awaiting;
+				default: return finished;
+			}
 		}
 
+		if (recv_buffer != 0xFF)
+			return finished;
+
 		sync_state = true;
 		return syncing;
 	}
 
+	/* responses use the same frame check as the request */
+	void set_frame_check(frame_check_t mode)
+	{
+		recv_mode = mode;
+		recv_checksum = frame_check::chk_init[mode];
+		send.set_frame_check(mode);
+	}
+
 	command_state_t search_for_command()
 	{
+		/* hunt for the sync word, 0xFF is never a command */
+		if (recv_buffer == 0xFF) {
+			set_frame_check(additive_checksum);
+			sync_state = true;
+			return awaiting;
+		}
+		if (sync_state) {
+			sync_state = false;
+			if (recv_buffer == 0xFD) {
+				set_frame_check(crc8_checksum);
+				return awaiting;
+			}
+		}
+
 		switch(recv_buffer)
 		{
 			/* single byte commands */
@@ -340,14 +1185,38 @@ public:
 			case 0xA0: /* 1010.0000 */ cmd_id = set_pwm_limit;           break;
 			case 0x70: /* 0111.0000 */ cmd_id = set_id;                  break;
 			case 0x40: /* 0100.0000 */ cmd_id = ext_sensor_request;      break;
+			case 0x50: /* 0101.0000 */ cmd_id = read_registers;          break;
+			case 0x60: /* 0110.0000 */ cmd_id = write_registers;         break;
+			case 0xB8: /* 1011.1000 */ cmd_id = set_voltage_all;         break;
+			case 0xC8: /* 1100.1000 */ cmd_id = data_requested_all;      break;
+			case 0xF0: /* 1111.0000 */ cmd_id = sync_frame;              return verifying;
+			case 0x30: /* 0011.0000 */ cmd_id = batch;                   break;
+			case 0xF8: /* 1111.1000 */ cmd_id = set_baudrate_all;        return reading;
+			case 0x10: /* 0001.0000 */ cmd_id = capabilities_request;    break;
+			case 0x20: /* 0010.0000 */ cmd_id = diagnostics_request;     break;
+			case 0x58: /* 0101.1000 */ cmd_id = read_trace;              break;
 
 			/* read but ignore sensorimotor responses */
 			case 0xE1: /* 1110.0001 */ cmd_id = ping_response;           break;
 			case 0x71: /* 0111.0001 */ cmd_id = set_id_response;         break;
-			case 0x80: /* 1000.0000 */ cmd_id = data_requested_response; break;
+			case 0x80: /* 1000.0000 */ cmd_id = data_requested_response;
+			                           cmd_bytes_expected = 11;          break;
 			case 0x41: /* 0400.0001 */ cmd_id = ext_sensor_request_resp; break;
-
-			default: /* unknown command */
+			case 0x51: /* 0101.0001 */ cmd_id = read_registers_resp;     break;
+			case 0x31: /* 0011.0001 */ cmd_id = batch_response;          break;
+			case 0x11: /* 0001.0001 */ cmd_id = capabilities_response;   break;
+			case 0x21: /* 0010.0001 */ cmd_id = diagnostics_response;    break;
+			case 0x59: /* 0101.1001 */ cmd_id = read_trace_resp;         break;
+
+			default:
+				/* data response with selected fields, 1001.nnnn */
+				if ((recv_buffer & 0xF0) == 0x90) {
+					cmd_id = data_requested_response;
+					cmd_bytes_expected = 2 * (recv_buffer & 0x0F) + 1;
+					break;
+				}
+				/* unknown command */
+				count(diag.unknown_commands);
 				return error;
 
 		} /* switch recv_buffer */
@@ -361,51 +1230,75 @@ public:
 		switch(cmd_state)
 		{
 			case syncing:
-				if (not byte_received()) return false;
+				if (not byte_received()) return sync_state and timed_out();
 				cmd_state = get_sync_bytes();
 				break;
 
 			case awaiting:
-				if (not byte_received()) return false;
+				if (not byte_received()) return timed_out();
 				cmd_state = search_for_command();
 				break;
 
 			case get_id:
-				if (not byte_received()) return false;
+				if (not byte_received()) return timed_out();
 				cmd_state = waiting_for_id();
 				break;
 
 			case reading:
-				if (not byte_received()) return false;
+				if (not byte_received()) return timed_out();
 				cmd_state = waiting_for_data();
 				break;
 
 			case eating:
-				if (not byte_received()) return false;
+				if (not byte_received()) return timed_out();
 				cmd_state = eating_others_data();
+				if (cmd_state == finished) count(diag.frames_eaten);
 				break;
 
 			case verifying:
-				if (not byte_received()) return false;
+				if (not byte_received()) return timed_out();
+				/* taken right at the final byte, not when processed */
+				if (cmd_id == sync_frame) sync_phase = clock_sync::get_phase();
 				cmd_state = verify_checksum();
 				break;
 
 			case pending:
+				confirm_baudrate();
 				cmd_state = process_command();
+				if (group_addressed) send.discard(); /* group members never respond */
 				break;
 
 			case finished: /* cleanup, prepare for next message */
-				send.flush();
+				if (send.flush()) count(diag.responses_sent);
 				cmd_id = no_command;
 				cmd_state = syncing;
+				recv_mode = additive_checksum;
 				num_bytes_eaten = 0;
+				cmd_bytes_received = 0;
+				cmd_bytes_expected = 0;
+				target_selected = false;
+				entry_selected = false;
+				group_addressed = false;
+				slot_position = 0;
+				slot_size = 0;
+				reg_len = 0;
+				batch_len = 0;
+				diag_reset = false;
 				recv_checksum = 0;
 				assert(sync_state == false, 55);
 				/* anything else todo? */
 				break;
 
+			case delaying: /* wait for own time slot */
+				while (byte_received()); /* discard responses of preceding motors */
+				if (not timer::elapsed(slot_start, slot_delay)) return false;
+				prepare_data_response();
+				cmd_state = finished;
+				break;
+
 			case error:
 				if (errors < 0xffff) ++errors;
+				com_faults |= fault::com_error;
 				led::yellow::set();
 				send.discard();
 				cmd_state = finished;
@@ -419,9 +1312,19 @@ public:
 		return true; // continue
 	}
 
+	/* bytes lost by the uart are reported by its error flags */
+	void check_rx_errors(void) {
+		if (Uart0::getErrorFlags() == 0) return;
+		count(diag.rx_errors);
+		Uart0::acknowledgeErrorFlags();
+	}
+
 	inline
 	void step() {
+		check_rx_errors();
 		while(receive_command());
+		stream();
+		check_baudrate();
 	}
 };
 
@@ -0,0 +1,62 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_CONTROL_RATE_HPP
+#define SUPREME_CONTROL_RATE_HPP
+
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Rate of the control loop, selected at compile time with
+	-DSUPREME_CONTROL_RATE_HZ=<rate>, default 1000.
+
+	Timer 0 runs in CTC mode with prescaler 64:
+	16MHz / 64 = 250.000 increments per second, hence the compare value
+	is 250.000 / rate - 1. Only rates dividing 250.000 without remainder
+	and up to 256 increments per cycle are exact, e.g.
+	1000Hz (249), 1250Hz (199), 2000Hz (124), 2500Hz (99), 3125Hz (79).
+
+	All time constants of the control loop are given in ms or Hz and
+	converted to control cycles here.
+*/
+
+#ifndef SUPREME_CONTROL_RATE_HZ
+#define SUPREME_CONTROL_RATE_HZ 1000
+#endif
+
+namespace supreme {
+namespace control_rate {
+
+	const uint32_t timer_hz = 250000; /* timer 0 increments per second */
+
+	constexpr uint16_t hz = SUPREME_CONTROL_RATE_HZ;
+
+	static_assert(hz >= 1000, "Control rate below 1kHz.");
+	static_assert(timer_hz % hz == 0, "Control rate is not exact with timer 0 prescaler 64.");
+	static_assert(timer_hz / hz <= 256, "Control rate too low for timer 0.");
+
+	constexpr uint8_t  compare      = timer_hz / hz - 1; /* OCR0A */
+	constexpr uint16_t us_per_cycle = 1000000UL / hz;
+
+	constexpr uint16_t ms_to_cycles(uint16_t ms) { return (uint32_t) ms * hz / 1000; }
+
+	/* rate relative to 1kHz in 1/256, scales per-cycle into per-ms values */
+	constexpr uint16_t scale_x256 = (uint32_t) hz * 256 / 1000;
+
+	static_assert((uint32_t) scale_x256 * 1000 == (uint32_t) hz * 256, "Control rate not a multiple of 125/32 Hz.");
+
+	constexpr uint8_t log2(uint32_t x) { return (x < 2) ? 0 : 1 + log2(x / 2); }
+
+	/* octaves of the rate above 1kHz, rounded (x sqrt(2) ~ 181/128),
+	   scales the shift of per-cycle exponential filters */
+	constexpr uint8_t octaves = log2((uint32_t) scale_x256 * 181 / 128 / 256);
+
+} /* namespace control_rate */
+} /* namespace supreme */
+
+#endif /* SUPREME_CONTROL_RATE_HPP */
@@ -9,7 +9,11 @@
 #ifndef SUPREME_SENSORIMOTOR_CORE_HPP
 #define SUPREME_SENSORIMOTOR_CORE_HPP
 
+#include <avr/pgmspace.h>
 #include <system/adc.hpp>
+#include <system/status.hpp>
+#include <system/control_rate.hpp>
+#include <system/excitation.hpp>
 #include <common/temperature.hpp>
 
 namespace supreme {
@@ -17,7 +21,14 @@ namespace supreme {
 namespace defaults {
 	const uint8_t pwm_limit = 32; /* 12,5% duty cycle */
 
-	const int16_t lut_1byX[501] = { /* TODO: reduce memory footprint of this LUT */
+	const uint8_t  watchcat_10ms   = 10; /* stop after 100ms without motor request */
+	const uint16_t max_dt          = control_rate::ms_to_cycles(1000); /* velocity averaging, max. 1s */
+	const uint16_t ramp_cycles     = control_rate::ms_to_cycles(1); /* ramp down by one pwm step per ms */
+	const uint8_t  lowpass_shift   = 1 + control_rate::octaves; /* position lowpass, 1/2 per cycle at 1kHz */
+
+	static_assert(lowpass_shift <= 5, "Position lowpass exceeds 16 bit.");
+
+	const int16_t lut_1byX[501] PROGMEM = { /* in flash, saves 1kB of RAM */
 	   0, 1000, 500, 333, 250, 200, 166, 142, 125, 111, 100, 90, 83, 76, 71, 66, 62, 58, 55, 52, 50, 47, 45, 43, 41, 40, 38, 37, 35, 34, 33, 32, 31, 30, 29, 28, 27, 27, 26, 25, 25, 24, 23, 23, 22, 22, 21, 21, 20, 20, 20, 19, 19, 18, 18, 18, 17, 17, 17, 16, 16, 16, 16, 15, 15, 15, 15, 14, 14, 14, 14, 14, 13, 13, 13, 13, 13, 12, 12, 12, 12, 12, 12, 12, 11, 11, 11, 11, 11, 11, 11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2
 	};
 }
@@ -36,6 +47,7 @@ public:
 	{
 		for (uint8_t i = 0; i < 6; ++i)
 			f[i] = (int16_t) adc::result[adc::position];
+		lowpass = f[0] << defaults::lowpass_shift;
 	}
 
 	void step(void)
@@ -44,15 +56,21 @@ public:
 		current          = adc::result[adc::current];
 		voltage_back_emf = adc::result[adc::voltage_back_emf];
 		voltage_supply   = adc::result[adc::voltage_supply];
-		temperature      = get_temperature_celsius(adc::result[adc::temperature]);
 
 		/* increment dt for velocity averaging.
-		   count time steps up to 1000ms.
+		   count control cycles up to 1000ms.
 		*/
-		if (dt < 1000) ++dt; // increment time delta for differentiator
+		if (dt < defaults::max_dt) ++dt; // increment time delta for differentiator
+
+		/* additional simple IIR lowpass filter, the shift is scaled
+		   by the control rate for a cutoff independent of the rate */
+		lowpass += adc::result[adc::position] - (lowpass >> defaults::lowpass_shift);
+		f[0] = lowpass >> defaults::lowpass_shift;
+	}
 
-		/* additional simple IIR lowpass filter */
-		f[0] = (int16_t) (f[0] + adc::result[adc::position]) >> 1;
+	/* temperature changes slowly, hence converted at a lower rate */
+	void update_temperature(void) {
+		temperature = get_temperature_celsius(adc::result[adc::temperature]);
 	}
 
 	/* get velocity and restart averaging */
@@ -64,9 +82,13 @@ public:
 		f[2] = f[1];
 		f[1] = f[0];
 
-		if (dt == 1000) { dt = 0; return 0; } // return 0, if time delta is too long.
+		if (dt == defaults::max_dt) { dt = 0; return 0; } // return 0, if time delta is too long.
 
-		int16_t g = (dt < 500) ? defaults::lut_1byX[dt] : 1;
+		/* 1/dt with dt in ms, the lut is indexed by control cycles,
+		   hence scaled for control rates above 1kHz */
+		int16_t g = (dt < 500) ? (int16_t) pgm_read_word(&defaults::lut_1byX[dt]) : 1;
+		if (control_rate::hz != 1000)
+			g = ((int32_t) g * control_rate::scale_x256) >> 8;
 
 		/* Differentiation filter with noise reduction
 		   optimized for integer arithmetics:
@@ -85,10 +107,22 @@ public:
 	}
 
 private:
-	uint16_t dt = 1000;
+	uint16_t dt = defaults::max_dt;
 	 int16_t f[6];
+	uint16_t lowpass; /* f[0] with lowpass_shift fractional bits */
 };
 
+/* behavior when the watchcat trips */
+namespace stop {
+	enum mode_t {
+		coast = 0, /* motor bridge disabled at once (default) */
+		ramp  = 1, /* pwm ramped down, then coast */
+		hold  = 2, /* hold position, proportional control with hold gain */
+		brake = 3, /* both low-side switches on */
+		num_modes
+	};
+}
+
 template <typename MotorDriverType>
 class sensorimotor_core {
 
@@ -102,8 +136,20 @@ class sensorimotor_core {
 	Sensors          sensors;
 	MotorDriverType  motor;
 
-	uint8_t          watchcat = 0;
+	uint16_t         watchcat = 0;
+	uint8_t          watchcat_timeout = defaults::watchcat_10ms;
+	uint16_t         watchcat_limit = control_rate::ms_to_cycles(10 * defaults::watchcat_10ms);
+	uint8_t          stop_mode = stop::coast;
+	bool             stopping = false; /* safe stop after watchcat trip */
+	uint16_t         ramp_count = 0;
+	uint16_t         hold_position = 0;
+	int8_t           hold_gain = 0;
 	uint8_t          max_pwm = defaults::pwm_limit;
+	uint8_t          faults = 0; /* latched until read */
+	uint16_t         ticks = 0;  /* control cycle counter */
+	uint16_t         watchcat_trips = 0;
+	uint16_t         sample_tick = 0;
+	excitation::generator ident; /* system identification */
 
 public:
 
@@ -118,7 +164,8 @@ public:
 	}
 
 	void apply_target_values(void) {
-		if (enabled) {
+		if (stopping) safe_stop();
+		if (enabled or stopping) {
 			motor.set_pwm(target.pwm);
 			motor.set_dir(target.dir);
 			motor.enable();
@@ -132,20 +179,113 @@ public:
 	void init_sensors(void) { sensors.init(); }
 
 	void step(void) {
+		if (ident.is_running()) excite();
 		apply_target_values();
 		sensors.step();
+		sample_tick = ticks++; /* stamp of the adc scan just read */
 
 		/* safety switchoff */
-		if (watchcat < 100) watchcat++;
-		else enabled = false;
+		if (watchcat < watchcat_limit) watchcat++;
+		else if (enabled) {
+			enabled = false;
+			faults |= fault::watchcat;
+			if (watchcat_trips < 0xffff) ++watchcat_trips;
+			stopping = (stop_mode != stop::coast);
+			ramp_count = 0;
+			hold_position = sensors.position;
+		}
+	}
+
+	/* drives the motor after the watchcat tripped, until the next motor request */
+	void safe_stop(void) {
+		switch(stop_mode)
+		{
+			case stop::ramp:
+				if (++ramp_count < defaults::ramp_cycles) break;
+				ramp_count = 0;
+				if (target.pwm > 0) --target.pwm;
+				else stopping = false; /* coast */
+				break;
+
+			case stop::hold: {
+				/* error in adc steps, a positive gain assumes dir set increases
+				   the position, use a negative gain otherwise */
+				const int16_t error = ((int32_t) hold_position - sensors.position) >> 6;
+				const int16_t u = (int32_t) error * hold_gain / 8;
+				const uint16_t pwm = (u < 0) ? -u : u;
+				target.dir = (u >= 0);
+				target.pwm = (pwm < max_pwm) ? pwm : max_pwm;
+				break;
+			}
+			case stop::brake:
+			default:
+				target.pwm = 0; /* enabled bridge with zero pwm brakes */
+				break;
+		}
+	}
+
+	/* the excitation replaces motor requests for the length of the run,
+	   then the motor is disabled */
+	void excite(void) {
+		int16_t u;
+		if (not ident.next(u)) {
+			disable();
+			return;
+		}
+		const uint16_t pwm = (u < 0) ? -u : u;
+		target.dir = (u >= 0);
+		target.pwm = (pwm < max_pwm) ? pwm : max_pwm;
+		watchcat = 0; /* the run is bounded by its length */
+	}
+
+	void start_identification(void) {
+		ident.start();
+		enabled = true;
+		watchcat = 0;
+		stopping = false;
+	}
+
+	void stop_identification(void) { if (ident.is_running()) disable(); }
+	bool is_identifying(void) const { return ident.is_running(); }
+	excitation::generator& get_excitation(void) { return ident; }
+
+	/* 100Hz tasks */
+	void health_step(void) {
+		sensors.update_temperature();
 	}
 
 	void set_pwm_limit (uint8_t lim) { max_pwm = lim; }
-	void set_target_pwm(uint8_t pwm) { target.pwm = pwm < max_pwm ? pwm : max_pwm; }
+	void set_target_pwm(uint8_t pwm) {
+		if (pwm > max_pwm) faults |= fault::pwm_limited;
+		target.pwm = pwm < max_pwm ? pwm : max_pwm;
+	}
 	void set_target_dir(bool    dir) { target.dir = dir; }
 
-	void enable()  { enabled = true; watchcat = 0; }
-	void disable() { enabled = false; }
+	uint8_t get_pwm_limit() const { return max_pwm; }
+	uint8_t get_target_pwm() const { return target.pwm; }
+	bool    get_target_dir() const { return target.dir; }
+
+	/* watchcat timeout in 10ms, 0: default */
+	void set_watchcat_timeout(uint8_t t) {
+		watchcat_timeout = t ? t : defaults::watchcat_10ms;
+		watchcat_limit = control_rate::ms_to_cycles(10 * watchcat_timeout);
+	}
+	uint8_t get_watchcat_timeout() const { return watchcat_timeout; }
+	void    set_stop_mode(uint8_t m) { stop_mode = (m < stop::num_modes) ? m : (uint8_t) stop::coast; }
+	uint8_t get_stop_mode() const    { return stop_mode; }
+	void    set_hold_gain(int8_t g)  { hold_gain = g; }
+	int8_t  get_hold_gain() const    { return hold_gain; }
+	bool    is_stopping() const      { return stopping; }
+
+	uint16_t get_watchcat_trips() const { return watchcat_trips; }
+	void     reset_watchcat_trips()     { watchcat_trips = 0; }
+
+	/* returns latched faults and clears them */
+	uint8_t get_faults() { uint8_t f = faults; faults = 0; return f; }
+
+	/* motor and state requests end a running identification */
+	void enable()  { enabled = true; watchcat = 0; stopping = false; ident.stop(); }
+	void disable() { enabled = false; stopping = false; ident.stop(); }
 	bool is_enabled() const { return enabled; }
 
 	uint16_t get_position        () const { return sensors.position; }
@@ -154,6 +294,11 @@ public:
 	uint16_t get_voltage_back_emf() const { return sensors.voltage_back_emf; }
 	uint16_t get_voltage_supply  () const { return sensors.voltage_supply; }
 	uint16_t get_temperature     () const { return sensors.temperature; }
+
+	/* the next control cycle is stamped with the given tick */
+	void     set_ticks(uint16_t t)      { ticks = t; }
+	uint16_t get_ticks           () const { return ticks; }
+	uint16_t get_sample_tick     () const { return sample_tick; }
 };
 
 } /* namespace supreme */
@@ -0,0 +1,151 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_EXCITATION_HPP
+#define SUPREME_EXCITATION_HPP
+
+#include <xpcc/architecture/platform.hpp>
+#include <avr/pgmspace.h>
+#include <system/control_rate.hpp>
+#include <system/trace.hpp>
+
+/*
+	Excitation signals for system identification, one value per control
+	cycle, as signed pwm (negative for direction 0).
+
+	PRBS: pseudo-random binary sequence of a 16 bit maximum length LFSR
+	      (x^16 + x^14 + x^13 + x^11 + 1), each bit held for a number of
+	      cycles, output is bias +/- amplitude. The same seed yields the
+	      same sequence.
+
+	Chirp: sine with the frequency swept linearly from f0 to f1 (0.1Hz
+	       units) over the run, output is bias + amplitude * sin.
+
+	The watchcat is paused during a run, hence the length is limited to
+	5s, which is the hard timeout of the identification. The default
+	length fits into the trace with its default channels.
+*/
+
+namespace supreme {
+namespace excitation {
+
+	enum signal_t {
+		prbs  = 0,
+		chirp = 1,
+		num_signals
+	};
+
+	static_assert((uint32_t) 5000 * control_rate::hz / 1000 <= 0xffff, "Run length exceeds 16 bit.");
+
+	const uint16_t max_length = control_rate::ms_to_cycles(5000); /* cycles */
+	const uint16_t default_length = trace::buffer_words / trace::default_words;
+
+	/* sin(i/64 * pi/2) * 127, quarter wave */
+	const uint8_t quarter_sine[65] PROGMEM = {
+		  0,   3,   6,   9,  12,  16,  19,  22,  25,  28,  31,  34,  37,  40,  43,  46,
+		 49,  51,  54,  57,  60,  63,  65,  68,  71,  73,  76,  78,  81,  83,  85,  88,
+		 90,  92,  94,  96,  98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+		117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+		127
+	};
+
+	/* phase 0..0xffff is one period */
+	inline int8_t sine(uint16_t phase) {
+		const uint8_t p = phase >> 8;
+		const uint8_t i = p & 0x3F;
+		const int8_t  s = pgm_read_byte(&quarter_sine[(p & 0x40) ? 64 - i : i]);
+		return (p & 0x80) ? -s : s;
+	}
+
+	/* phase increment per control cycle, phase 2^32 is one period */
+	inline uint32_t increment(uint16_t f_0p1Hz) {
+		const uint32_t div = 10ul * control_rate::hz;
+		const uint32_t f = (uint32_t) f_0p1Hz << 16;
+		return ((f / div) << 16) + (((f % div) << 16) / div);
+	}
+
+	class generator {
+		/* parameters */
+		uint8_t  signal = prbs;
+		uint8_t  amplitude = 0;
+		int8_t   bias = 0;
+		uint16_t length = default_length;
+		uint16_t seed = 0xACE1;
+		uint8_t  hold = 1;           /* cycles per prbs bit */
+		uint16_t f0 = 10;            /* 1Hz */
+		uint16_t f1 = 1000;          /* 100Hz */
+
+		/* run */
+		bool     running = false;
+		uint16_t remaining = 0;
+		uint16_t lfsr = 0;
+		uint8_t  hold_count = 0;
+		uint32_t phase = 0;
+		uint32_t inc = 0;
+		int32_t  sweep = 0;
+
+	public:
+
+		void start(void) {
+			running = true;
+			remaining = length;
+			lfsr = seed ? seed : 1; /* zero locks up */
+			hold_count = 0;
+			phase = 0;
+			inc = increment(f0);
+			sweep = length ? ((int32_t) increment(f1) - (int32_t) inc) / length : 0;
+		}
+
+		void stop(void) { running = false; }
+		bool is_running(void) const { return running; }
+
+		/* value of the next cycle, false when the run is over */
+		bool next(int16_t& u) {
+			if (remaining == 0) { running = false; return false; }
+			--remaining;
+
+			int16_t x;
+			if (signal == chirp) {
+				x = (int16_t) amplitude * sine(phase >> 16) / 128;
+				phase += inc;
+				inc += sweep;
+			} else {
+				x = (lfsr & 0x1) ? amplitude : -amplitude;
+				if (++hold_count >= hold) {
+					hold_count = 0;
+					lfsr = (lfsr >> 1) ^ ((lfsr & 0x1) ? 0xB400 : 0);
+				}
+			}
+			x += bias;
+			u = (x > 255) ? 255 : (x < -255) ? -255 : x;
+			return true;
+		}
+
+		void set_signal   (uint8_t s)  { signal = (s < num_signals) ? s : (uint8_t) prbs; }
+		void set_amplitude(uint8_t a)  { amplitude = a; }
+		void set_bias     (int8_t b)   { bias = b; }
+		void set_length   (uint16_t n) { length = (n < max_length) ? n : max_length; }
+		void set_seed     (uint16_t s) { seed = s; }
+		void set_hold     (uint8_t h)  { hold = h ? h : 1; }
+		void set_f0       (uint16_t f) { f0 = f; }
+		void set_f1       (uint16_t f) { f1 = f; }
+
+		uint8_t  get_signal   (void) const { return signal; }
+		uint8_t  get_amplitude(void) const { return amplitude; }
+		int8_t   get_bias     (void) const { return bias; }
+		uint16_t get_length   (void) const { return length; }
+		uint16_t get_seed     (void) const { return seed; }
+		uint8_t  get_hold     (void) const { return hold; }
+		uint16_t get_f0       (void) const { return f0; }
+		uint16_t get_f1       (void) const { return f1; }
+	};
+
+} /* namespace excitation */
+} /* namespace supreme */
+
+#endif /* SUPREME_EXCITATION_HPP */
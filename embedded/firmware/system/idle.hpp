@@ -0,0 +1,56 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_IDLE_HPP
+#define SUPREME_IDLE_HPP
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Idle sleep of the main loop.
+
+	In idle mode the cpu stops, while timers, uart, adc and twi keep
+	running and wake it by their interrupts. Every task of the main loop
+	is driven by one of them (control tick, received bytes, adc scan, i2c
+	transfers) or polls the time base, which wakes the cpu at least every
+	512us. Tasks waiting for a precise time, like bus slots and
+	streaming, must prevent sleeping.
+
+	The wake conditions are checked with interrupts disabled. sei() takes
+	effect after the next instruction, so no interrupt can slip in between
+	the check and sleep_cpu() and delay its handling until the next one.
+*/
+
+namespace supreme {
+namespace idle {
+
+	inline void init(void) { set_sleep_mode(SLEEP_MODE_IDLE); }
+
+	/* sleeps until the next interrupt, unless a control tick or a byte
+	   arrived meanwhile, returns true if the cpu slept */
+	inline bool sleep(volatile uint8_t& ticks, uint8_t seen)
+	{
+		cli();
+		if (ticks != seen or Uart0::receiveBufferSize() > 0) {
+			sei();
+			return false;
+		}
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		return true;
+	}
+
+} /* namespace idle */
+} /* namespace supreme */
+
+#endif /* SUPREME_IDLE_HPP */
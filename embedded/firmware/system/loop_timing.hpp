@@ -0,0 +1,133 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_LOOP_TIMING_HPP
+#define SUPREME_LOOP_TIMING_HPP
+
+#include <xpcc/architecture/platform.hpp>
+#include <system/timer.hpp>
+
+/*
+	Timing statistics of the control loop, readable as registers.
+
+	The control tick isr stamps the tick with the free-running time base
+	(timer 2, 2us resolution). The start latency is measured from the tick
+	to the begin of the control group, the start jitter is the spread of
+	the latency. The execution time of the control group is tracked as
+	min, max, mean and log2 histogram:
+
+	  bin 0: < 16us, bin k: 2^(k+3)..2^(k+4) us, bin 7: >= 1024us
+
+	The scheduler counts overruns per rate group and missed ticks here.
+
+	When the main loop was woken from idle sleep by the control tick, the
+	time from the tick to the wake-up is tracked as wake latency.
+*/
+
+namespace supreme {
+namespace timing {
+
+	const uint8_t num_bins   = 8;
+	const uint8_t max_groups = 4; /* rate groups of the scheduler */
+
+	class loop_timing {
+		volatile uint16_t tick_time = 0;   /* written by isr */
+		uint16_t start_time = 0;
+
+		uint16_t exec_min;
+		uint16_t exec_max;
+		uint16_t exec_mean_x16;            /* fixed point, mean * 16 */
+		uint16_t latency_min;
+		uint16_t latency_max;
+		uint16_t hist[num_bins];
+		uint16_t overruns[max_groups];
+		uint16_t missed_ticks;
+		uint16_t wake_max;
+		uint16_t sleeps;
+
+	public:
+
+		loop_timing() { reset(); }
+
+		void reset(void) {
+			exec_min = 0xffff;
+			exec_max = 0;
+			exec_mean_x16 = 0;
+			latency_min = 0xffff;
+			latency_max = 0;
+			for (uint8_t i = 0; i < num_bins; ++i) hist[i] = 0;
+			for (uint8_t i = 0; i < max_groups; ++i) overruns[i] = 0;
+			missed_ticks = 0;
+			wake_max = 0;
+			sleeps = 0;
+		}
+
+		/* called by the control tick isr */
+		void tick(void) { tick_time = timer::now(); }
+
+		/* called right after the tick was noticed, the next tick
+		   and hence the isr writing tick_time is a cycle away */
+		void begin(void) {
+			start_time = timer::now();
+			const uint16_t latency = start_time - tick_time;
+			if (latency < latency_min) latency_min = latency;
+			if (latency > latency_max) latency_max = latency;
+		}
+
+		void end(void) {
+			const uint16_t exec = timer::now() - start_time;
+			if (exec < exec_min) exec_min = exec;
+			if (exec > exec_max) exec_max = exec;
+			/* exponential moving average, time constant 16 cycles */
+			if (exec_mean_x16 == 0) exec_mean_x16 = exec << 4;
+			else exec_mean_x16 += exec - (exec_mean_x16 >> 4);
+			saturating_inc(hist[bin(exec)]);
+		}
+
+		/* called after idle sleep, woken_by_tick if the control tick ended it */
+		void woken(bool woken_by_tick) {
+			saturating_inc(sleeps);
+			if (not woken_by_tick) return;
+			const uint16_t latency = timer::now() - tick_time;
+			if (latency > wake_max) wake_max = latency;
+		}
+
+		void count_overrun(uint8_t group) { saturating_inc(overruns[group]); }
+		void count_missed (uint8_t n) {
+			missed_ticks = (missed_ticks < 0xffff - n) ? missed_ticks + n : 0xffff;
+		}
+
+		/* all times in microseconds, 0 if nothing was measured yet */
+		uint16_t get_exec_min (void) const { return (exec_max ? exec_min : 0) * timer::us_per_tick; }
+		uint16_t get_exec_max (void) const { return exec_max * timer::us_per_tick; }
+		uint16_t get_exec_mean(void) const { return (exec_mean_x16 >> 4) * timer::us_per_tick; }
+		uint16_t get_jitter   (void) const { return (latency_max ? latency_max - latency_min : 0) * timer::us_per_tick; }
+		uint16_t get_histogram(uint8_t i) const { return (i < num_bins) ? hist[i] : 0; }
+		uint16_t get_overruns (uint8_t g) const { return (g < max_groups) ? overruns[g] : 0; }
+		uint16_t get_missed_ticks(void)   const { return missed_ticks; }
+		uint16_t get_wake_latency(void)   const { return wake_max * timer::us_per_tick; }
+		uint16_t get_sleeps      (void)   const { return sleeps; }
+
+	private:
+		static void saturating_inc(uint16_t& c) { if (c < 0xffff) ++c; }
+
+		/* log2 of the duration in units of 16us (8 ticks) */
+		static uint8_t bin(uint16_t ticks) {
+			uint8_t b = 0;
+			ticks >>= 3;
+			while (ticks and b < num_bins - 1) { ticks >>= 1; ++b; }
+			return b;
+		}
+	};
+
+	extern loop_timing loop; /* defined in main.cpp */
+
+} /* namespace timing */
+} /* namespace supreme */
+
+#endif /* SUPREME_LOOP_TIMING_HPP */
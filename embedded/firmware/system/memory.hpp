@@ -0,0 +1,65 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_MEMORY_HPP
+#define SUPREME_MEMORY_HPP
+
+#include <avr/io.h>
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Stack painting and RAM usage.
+
+	Right after reset (section .init3), the RAM between
+	the end of static data and the top of RAM is painted with a fixed
+	pattern. The deepest stack use since reset is found by searching the
+	first byte which was overwritten (high-water mark). The search is
+	done on request only, it takes approx. 100us per kB.
+
+	  __data_start ... _end   static data (.data, .bss)
+	  _end ... high-water     never used (painted)
+	  high-water ... RAMEND   stack, deepest use since reset
+*/
+
+/* provided by the linker */
+extern uint8_t __data_start;
+extern uint8_t _end;
+
+namespace supreme {
+namespace memory {
+
+	const uint8_t paint = 0xC5;
+
+	/* bytes of static data */
+	inline uint16_t static_size(void) { return &_end - &__data_start; }
+
+	/* bytes between static data and the deepest stack use */
+	inline uint16_t unused(void) {
+		const uint8_t* p = &_end;
+		while (p <= (const uint8_t*) RAMEND and *p == paint) ++p;
+		return p - &_end;
+	}
+
+	/* bytes of stack at the deepest use */
+	inline uint16_t stack_peak(void) {
+		return (uint16_t)((const uint8_t*) RAMEND - &_end) + 1 - unused();
+	}
+
+} /* namespace memory */
+} /* namespace supreme */
+
+/* runs inline in the startup code, while the stack is still empty */
+extern "C" void paint_stack(void) __attribute__ ((naked, used, section (".init3")));
+extern "C" void paint_stack(void)
+{
+	uint8_t* p = &_end;
+	while (p <= (uint8_t*) RAMEND)
+		*p++ = supreme::memory::paint;
+}
+
+#endif /* SUPREME_MEMORY_HPP */
@@ -0,0 +1,123 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_PROFILER_HPP
+#define SUPREME_PROFILER_HPP
+
+#include <xpcc/architecture/platform.hpp>
+#include <system/timer.hpp>
+
+/*
+	Per-section profiler, enabled at compile time with
+	-DSUPREME_PROFILING=1, otherwise all markers compile to nothing.
+
+	A marker is a scope object which adds the time from its construction
+	to its destruction to the named section. Time is measured with the
+	free-running time base (timer 2, 2us = 32 cpu cycles). Sections
+	shorter than that, like the adc isr, are still measured correctly
+	on average, since their start is not correlated to the time base.
+
+	The uart isrs are part of xpcc and can not be instrumented, their
+	time is included in the sections they interrupt.
+
+	Both variants live in their own inline namespace, so translation
+	units built with and without profiling can be linked together, as
+	the host tests do.
+*/
+
+#ifndef SUPREME_PROFILING
+#define SUPREME_PROFILING 0
+#endif
+
+namespace supreme {
+namespace profile {
+
+	enum section_t {
+		communication = 0, /* communication_ctrl::step */
+		control       = 1, /* sensorimotor_core::step */
+		adc_isr       = 2,
+		ext_sensor    = 3, /* ExternalSensor::step */
+		num_sections
+	};
+
+	const uint8_t cycles_per_tick = 32;
+
+#if SUPREME_PROFILING
+inline namespace enabled {
+
+	struct section_stats {
+		uint32_t ticks;  /* total time */
+		uint16_t calls;
+		uint16_t max;    /* longest call, in ticks */
+	};
+
+	extern volatile section_stats stats[num_sections]; /* defined in main.cpp */
+
+	inline void add(section_t s, uint16_t dt) {
+		const uint8_t sreg = SREG;
+		cli(); /* the adc isr adds as well */
+		stats[s].ticks += dt;
+		if (stats[s].calls < 0xffff) ++stats[s].calls;
+		if (dt > stats[s].max) stats[s].max = dt;
+		SREG = sreg;
+	}
+
+	class scope {
+		const section_t s;
+		const uint16_t start;
+	public:
+		explicit scope(section_t s) : s(s), start(timer::now()) {}
+		~scope() { add(s, timer::now() - start); }
+	};
+
+	inline void reset(void) {
+		const uint8_t sreg = SREG;
+		cli();
+		for (uint8_t i = 0; i < num_sections; ++i) {
+			stats[i].ticks = 0;
+			stats[i].calls = 0;
+			stats[i].max   = 0;
+		}
+		SREG = sreg;
+	}
+
+	/* returns word i of a section: total ticks (hi, lo), calls, max */
+	inline uint16_t get_word(section_t s, uint8_t i) {
+		const uint8_t sreg = SREG;
+		cli();
+		uint16_t w = 0;
+		switch(i) {
+			case 0: w = stats[s].ticks >> 16;    break;
+			case 1: w = stats[s].ticks & 0xffff; break;
+			case 2: w = stats[s].calls;          break;
+			case 3: w = stats[s].max;            break;
+			default: break;
+		}
+		SREG = sreg;
+		return w;
+	}
+
+} /* namespace enabled */
+#else /* profiling disabled */
+inline namespace disabled {
+
+	class scope {
+	public:
+		explicit scope(section_t) {}
+	};
+
+	inline void     reset(void) {}
+	inline uint16_t get_word(section_t, uint8_t) { return 0; }
+
+} /* namespace disabled */
+#endif /* SUPREME_PROFILING */
+
+} /* namespace profile */
+} /* namespace supreme */
+
+#endif /* SUPREME_PROFILER_HPP */
@@ -0,0 +1,37 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_RAM_BUDGET_HPP
+#define SUPREME_RAM_BUDGET_HPP
+
+/*
+	RAM budgets of the subsystems, in bytes.
+
+	The ATmega328p has 2048 bytes of SRAM, shared by static data (uart
+	buffers, tables, loop statistics) and the stack, which holds the
+	subsystem objects created in main(). The budgets are checked at
+	compile time (main.cpp) and by the host tests, where sizes are
+	larger due to wider pointers, hence passing there is conservative.
+*/
+
+namespace supreme {
+namespace ram_budget {
+
+	const unsigned ram_size      = 2048;
+
+	const unsigned core          =  96; /* sensorimotor_core, incl. excitation */
+	const unsigned communication = 192; /* communication_ctrl */
+	const unsigned ext_sensor    =  96; /* ExternalSensor */
+	const unsigned trace         = 544; /* trace recorder, static */
+
+	const unsigned stack_reserve = 256; /* interrupts and call depth */
+
+} /* namespace ram_budget */
+} /* namespace supreme */
+
+#endif /* SUPREME_RAM_BUDGET_HPP */
@@ -0,0 +1,232 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_REGISTERS_HPP
+#define SUPREME_REGISTERS_HPP
+
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Control table of the sensorimotor.
+
+	Registers are addressed bytewise and are either 8 or 16 bit wide,
+	words are transmitted msb first. Each register is marked as
+	read-only or writable and as stored in RAM (lost on reset) or EEPROM.
+
+	0x00..0x1F configuration
+	0x20..0x3F limits and gains
+	0x40..0x5F live telemetry (read-only)
+	0x60..0x7F control loop timing (read-only), see loop_timing.hpp
+	0x80..0x9F profiler sections (read-only), see profiler.hpp
+	0xA0..0xBF idle sleep and memory usage (read-only)
+	0xC0..0xDF trace recorder, see trace.hpp
+	0xE0..0xFF system identification, see excitation.hpp
+*/
+
+namespace supreme {
+namespace reg {
+
+	enum address_t {
+		/* configuration */
+		motor_id         = 0x00,
+		telemetry_mask   = 0x01,
+		stream_period    = 0x02,
+		stream_slot      = 0x03,
+		baudrate         = 0x04,
+		sync_mode        = 0x05,
+		ticks            = 0x06,
+		group_0          = 0x08,
+		group_1          = 0x09,
+		group_2          = 0x0A,
+		group_3          = 0x0B,
+		sync_offset      = 0x0C,
+		sync_trim        = 0x0E,
+		watchcat_timeout = 0x10,
+		stop_mode        = 0x11,
+
+		/* limits and gains */
+		pwm_limit        = 0x20,
+		hold_gain        = 0x21,
+
+		/* telemetry */
+		position         = 0x40,
+		current          = 0x42,
+		velocity         = 0x44,
+		voltage_back_emf = 0x46,
+		voltage_supply   = 0x48,
+		temperature      = 0x4A,
+		status           = 0x4C,
+
+		/* loop timing, times in us */
+		exec_min         = 0x60,
+		exec_max         = 0x62,
+		exec_mean        = 0x64,
+		start_jitter     = 0x66,
+		missed_ticks     = 0x68,
+		overruns_control = 0x6A,
+		overruns_health  = 0x6C,
+		overruns_backgnd = 0x6E,
+		hist_0           = 0x70,
+		hist_1           = 0x72,
+		hist_2           = 0x74,
+		hist_3           = 0x76,
+		hist_4           = 0x78,
+		hist_5           = 0x7A,
+		hist_6           = 0x7C,
+		hist_7           = 0x7E,
+
+		/* profiler, 4 words per section */
+		profile          = 0x80,
+
+		/* idle sleep */
+		wake_latency     = 0xA0,
+		sleeps           = 0xA2,
+
+		/* memory usage in bytes */
+		ram_static       = 0xA4,
+		ram_unused       = 0xA6,
+		stack_peak       = 0xA8,
+		size_core        = 0xAA,
+		size_com         = 0xAC,
+		size_ext_sensor  = 0xAE,
+
+		/* trace recorder */
+		trace_state      = 0xC0,
+		trace_channels   = 0xC1,
+		trace_divider    = 0xC2,
+		trigger_mode     = 0xC3,
+		trigger_channel  = 0xC4,
+		trigger_level    = 0xC6,
+		pre_trigger      = 0xC8,
+		trace_samples    = 0xCA,
+		trigger_pos      = 0xCC,
+		trace_capacity   = 0xCE,
+
+		/* system identification */
+		ident_state      = 0xE0,
+		ident_signal     = 0xE1,
+		ident_amplitude  = 0xE2,
+		ident_bias       = 0xE3,
+		ident_length     = 0xE4,
+		prbs_seed        = 0xE6,
+		prbs_hold        = 0xE8,
+		chirp_f0         = 0xEA,
+		chirp_f1         = 0xEC,
+	};
+
+	const uint8_t profile_len = 0x20;
+
+	/* register attributes */
+	enum attribute_t {
+		invalid  = 0x00, /* no register starts at this address */
+		byte     = 0x01,
+		word     = 0x02,
+		ram      = 0x00,
+		eeprom   = 0x04,
+		readonly = 0x00,
+		writable = 0x08,
+	};
+
+	const uint8_t max_access_len = 16; /* max. number of bytes per read or write */
+
+	inline uint8_t attributes(uint8_t addr) {
+		if (addr >= profile and addr < profile + profile_len)
+			return (addr & 0x1) ? invalid : word | ram | readonly;
+
+		switch(addr)
+		{
+			case motor_id        : return byte | eeprom | writable;
+			case telemetry_mask  : return byte | eeprom | writable;
+			case stream_period   :
+			case stream_slot     : return byte | ram    | writable;
+			case baudrate        : return byte | ram    | readonly;
+			case sync_mode       : return byte | ram    | writable;
+			case ticks           : return word | ram    | writable;
+			case group_0         :
+			case group_1         :
+			case group_2         :
+			case group_3         : return byte | eeprom | writable;
+			case sync_offset     :
+			case sync_trim       : return word | ram    | readonly;
+			case watchcat_timeout:
+			case stop_mode       : return byte | eeprom | writable;
+			case pwm_limit       :
+			case hold_gain       : return byte | ram    | writable;
+			case position        :
+			case current         :
+			case velocity        :
+			case voltage_back_emf:
+			case voltage_supply  :
+			case temperature     :
+			case status          : return word | ram    | readonly;
+			case exec_min        :
+			case exec_max        :
+			case exec_mean       :
+			case start_jitter    :
+			case missed_ticks    :
+			case overruns_control:
+			case overruns_health :
+			case overruns_backgnd:
+			case hist_0          :
+			case hist_1          :
+			case hist_2          :
+			case hist_3          :
+			case hist_4          :
+			case hist_5          :
+			case hist_6          :
+			case hist_7          : return word | ram    | readonly;
+			case wake_latency    :
+			case sleeps          :
+			case ram_static      :
+			case ram_unused      :
+			case stack_peak      :
+			case size_core       :
+			case size_com        :
+			case size_ext_sensor : return word | ram    | readonly;
+			case trace_state     :
+			case trace_channels  :
+			case trace_divider   :
+			case trigger_mode    :
+			case trigger_channel : return byte | ram    | writable;
+			case trigger_level   :
+			case pre_trigger     : return word | ram    | writable;
+			case trace_samples   :
+			case trigger_pos     :
+			case trace_capacity  : return word | ram    | readonly;
+			case ident_state     :
+			case ident_signal    :
+			case ident_amplitude :
+			case ident_bias      : return byte | ram    | writable;
+			case ident_length    :
+			case prbs_seed       : return word | ram    | writable;
+			case prbs_hold       : return byte | ram    | writable;
+			case chirp_f0        :
+			case chirp_f1        : return word | ram    | writable;
+			default: break;
+		}
+		return invalid;
+	}
+
+	inline uint8_t size       (uint8_t attr) { return attr & (byte | word); }
+	inline bool    is_writable(uint8_t attr) { return attr & writable; }
+
+} /* namespace reg */
+
+/* EEPROM memory layout */
+namespace eeprom_address {
+	const uint8_t motor_id         = 23;
+	const uint8_t telemetry_mask   = 24;
+	const uint8_t baudrate         = 25;
+	const uint8_t groups           = 26; /* 26..29 */
+	const uint8_t watchcat_timeout = 30;
+	const uint8_t stop_mode        = 31;
+}
+
+} /* namespace supreme */
+
+#endif /* SUPREME_REGISTERS_HPP */
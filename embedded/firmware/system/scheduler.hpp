@@ -0,0 +1,110 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_SCHEDULER_HPP
+#define SUPREME_SCHEDULER_HPP
+
+#include <xpcc/architecture/platform.hpp>
+#include <system/timer.hpp>
+#include <system/loop_timing.hpp>
+#include <system/control_rate.hpp>
+
+/*
+	Cooperative rate-group scheduler of the main loop.
+
+	The control tick (timer 0, 1kHz by default) drives all rate groups,
+	a group runs every 'divider' ticks. Background tasks run on every pass of the main
+	loop, after the due rate groups. Groups are never preempted, a group
+	taking longer than its budget is counted as overrun. Ticks which
+	passed unnoticed, because a pass took longer than a cycle, are counted
+	as missed. Counters and control group timing go to timing::loop.
+*/
+
+namespace supreme {
+namespace schedule {
+
+	enum group_t {
+		control    = 0, /* control rate: motor control, adc */
+		health     = 1, /* 100Hz: temperature */
+		background = 2, /* every pass: bus, external sensor */
+		num_groups
+	};
+
+	/* control ticks per run, 0: every pass */
+	constexpr uint8_t  divider  [num_groups] = { 1, control_rate::hz / 100, 0 };
+
+	/* max. execution time per run, 40%, 10% and 40% of a control cycle */
+	constexpr uint16_t budget_us[num_groups] = { control_rate::us_per_cycle * 4 / 10
+	                                           , control_rate::us_per_cycle     / 10
+	                                           , control_rate::us_per_cycle * 4 / 10 };
+
+	static_assert(budget_us[control] + budget_us[health] + budget_us[background] < control_rate::us_per_cycle,
+	              "Rate groups exceed the control cycle.");
+
+	static_assert(num_groups <= timing::max_groups, "Too many rate groups.");
+
+} /* namespace schedule */
+
+class scheduler {
+	uint8_t  last_tick = 0;
+	uint8_t  countdown[schedule::num_groups];
+	bool     due      [schedule::num_groups];
+	uint16_t started = 0;
+
+public:
+	scheduler()
+	{
+		for (uint8_t g = 0; g < schedule::num_groups; ++g) {
+			countdown[g] = schedule::divider[g];
+			due[g] = false;
+		}
+	}
+
+	/* call once per pass with the number of control ticks so far */
+	void update(uint8_t tick)
+	{
+		due[schedule::background] = true;
+
+		const uint8_t n = tick - last_tick;
+		if (n == 0) return;
+		last_tick = tick;
+		if (n > 1) timing::loop.count_missed(n - 1);
+
+		/* a group is run once, even if its period passed several times */
+		for (uint8_t g = 0; g < schedule::num_groups; ++g) {
+			if (schedule::divider[g] == 0) continue;
+			countdown[g] = (countdown[g] > n) ? countdown[g] - n : 0;
+			if (countdown[g] == 0) {
+				countdown[g] = schedule::divider[g];
+				due[g] = true;
+			}
+		}
+	}
+
+	/* returns true if the group is due, the caller then runs its tasks
+	   followed by end() */
+	bool begin(schedule::group_t g)
+	{
+		if (not due[g]) return false;
+		due[g] = false;
+		if (g == schedule::control) timing::loop.begin();
+		started = timer::now();
+		return true;
+	}
+
+	void end(schedule::group_t g)
+	{
+		if (g == schedule::control) timing::loop.end();
+		if (timer::elapsed(started, timer::us_to_ticks(schedule::budget_us[g])))
+			timing::loop.count_overrun(g);
+	}
+};
+
+} /* namespace supreme */
+
+#endif /* SUPREME_SCHEDULER_HPP */
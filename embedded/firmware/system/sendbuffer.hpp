@@ -11,16 +11,37 @@
 
 #include <xpcc/architecture/platform.hpp>
 #include <system/assert.hpp>
+#include <system/transmit.hpp>
+#include <common/crc8.hpp>
 
 namespace supreme {
 
+/* The 2nd sync byte selects the frame check of a message:
+   0xFF: additive checksum (protocol version 1.0)
+   0xFD: CRC-8
+*/
+enum frame_check_t {
+	additive_checksum = 0,
+	crc8_checksum     = 1,
+};
+
+namespace frame_check {
+	const uint8_t sync_byte[2] = { 0xFF, 0xFD };
+	const uint8_t chk_init [2] = { 0xFE   /* (0xff + 0xff) % 256 */
+	                             , 0x2A }; /* crc8(0xff, 0xfd)    */
+
+	inline uint8_t update(frame_check_t mode, uint8_t chk, uint8_t byte) {
+		return (mode == crc8_checksum) ? crc8_update(chk, byte) : chk + byte;
+	}
+}
+
 template <unsigned N>
 class sendbuffer {
 	static const unsigned NumSyncBytes = 2;
-	static const uint8_t chk_init = 0xFE; /* (0xff + 0xff) % 256 */
-	uint16_t  ptr = NumSyncBytes;
-	uint8_t   buffer[N];
-	uint8_t   checksum = chk_init;
+	uint16_t      ptr = NumSyncBytes;
+	uint8_t       buffer[N];
+	frame_check_t mode = additive_checksum;
+	uint8_t       checksum = frame_check::chk_init[additive_checksum];
 public:
 	sendbuffer()
 	{
@@ -28,32 +49,45 @@ public:
 		for (uint8_t i = 0; i < NumSyncBytes; ++i)
 			buffer[i] = 0xFF; // init sync bytes once
 	}
+	/* select frame check of next message, only while empty */
+	void set_frame_check(frame_check_t m) {
+		assert(ptr == NumSyncBytes, 9);
+		mode = m;
+		buffer[1] = frame_check::sync_byte[mode];
+		checksum = frame_check::chk_init[mode];
+	}
+	frame_check_t get_frame_check(void) const { return mode; }
 	void add_byte(uint8_t byte) {
 		assert(ptr < (N-1), 1);
 		buffer[ptr++] = byte;
-		checksum += byte;
+		checksum = frame_check::update(mode, checksum, byte);
 	}
 	void add_word(uint16_t word) {
 		add_byte((word  >> 8) & 0xff);
 		add_byte( word        & 0xff);
 	}
 	void discard(void) { ptr = NumSyncBytes; }
-	void flush() {
-		if (ptr == NumSyncBytes) return;
+	/* returns true, if a message was sent */
+	bool flush() {
+		if (ptr == NumSyncBytes) return false;
 		add_checksum();
 		send_mode();
-		Uart0::write(buffer, ptr);
-		Uart0::flushWriteBuffer();    //TODO do not wait here, set an flag and check in com step to switch into recv mode again
+		uart::transmit(buffer, ptr);  //TODO do not wait here, set an flag and check in com step to switch into recv mode again
 		receive_mode();
 		/* prepare next */
 		ptr = NumSyncBytes;
+		return true;
 	}
 	uint16_t size(void) const { return ptr; }
+	static constexpr uint16_t capacity(void) { return N; }
 private:
 	void add_checksum() {
 		assert(ptr < N, 8);
-		buffer[ptr++] = ~checksum + 1; /* two's complement checksum */
-		checksum = chk_init;
+		if (mode == crc8_checksum)
+			buffer[ptr++] = checksum;
+		else
+			buffer[ptr++] = ~checksum + 1; /* two's complement checksum */
+		checksum = frame_check::chk_init[mode];
 	}
 
 	// TODO move to (future) communication interface class
@@ -0,0 +1,43 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_STATUS_HPP
+#define SUPREME_STATUS_HPP
+
+/*
+	Status and fault bits reported in the data response.
+
+	Status bits reflect the current state. Fault bits are latched when
+	the event occurs and cleared once they were reported to the host.
+*/
+
+namespace supreme {
+
+namespace status {
+	enum status_t {
+		enabled          = 0x01, /* motor is driven */
+		direction        = 0x02, /* target direction */
+		streaming        = 0x04,
+		baud_unconfirmed = 0x08, /* new baud rate not yet confirmed */
+		stopping         = 0x10, /* watchcat tripped, safe stop until next motor request */
+		identifying      = 0x20, /* system identification running */
+	};
+}
+
+namespace fault {
+	enum fault_t {
+		watchcat         = 0x01, /* no motor request within the watchcat timeout */
+		pwm_limited      = 0x02, /* target pwm was clipped to the limit */
+		com_error        = 0x04, /* invalid message, e.g. checksum wrong */
+		com_timeout      = 0x08, /* message was cut off */
+	};
+}
+
+} /* namespace supreme */
+
+#endif /* SUPREME_STATUS_HPP */
@@ -0,0 +1,67 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_TIMER_HPP
+#define SUPREME_TIMER_HPP
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Free-running 16 bit time base for sub-millisecond timing.
+
+	Timer 2 is otherwise unused (timer 0: control loop, timer 1: motor pwm).
+	16MHz clock, prescaler 32 -> 500.000 increments per second -> 2us per tick.
+	The 8 bit counter is extended by counting overflows (every 512us),
+	hence the time base wraps around after approx. 131ms.
+*/
+
+namespace supreme {
+namespace timer {
+
+	const uint8_t us_per_tick = 2;
+
+	constexpr uint16_t us_to_ticks(uint16_t us) { return us / us_per_tick; }
+
+	/* registers changed by isr */
+	volatile uint8_t overflows = 0;
+
+	inline void init() {
+		TCCR2A = 0;                        // normal mode
+		TCCR2B = (1<<CS21) | (1<<CS20);    // set prescaler to 32
+		TCNT2  = 0;
+		TIMSK2 = (1<<TOIE2);               // enable overflow interrupt
+	}
+
+	inline uint16_t now(void) {
+		const uint8_t sreg = SREG;
+		cli();
+		uint8_t lo = TCNT2;
+		uint8_t hi = overflows;
+		if ((TIFR2 & (1<<TOV2)) and lo < 128) ++hi; // overflow pending, not yet counted
+		SREG = sreg;
+		return (hi << 8) | lo;
+	}
+
+	/* wrap-around safe, for durations below 131ms */
+	inline bool elapsed(uint16_t since, uint16_t ticks) { return (uint16_t)(now() - since) >= ticks; }
+
+	/* wrap-around safe, for deadlines less than 65ms ahead or behind */
+	inline bool reached(uint16_t deadline) { return (int16_t)(now() - deadline) >= 0; }
+
+} /* namespace timer */
+
+ISR(TIMER2_OVF_vect)
+{
+	++timer::overflows;
+}
+
+} /* namespace supreme */
+
+#endif /* SUPREME_TIMER_HPP */
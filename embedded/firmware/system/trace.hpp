@@ -0,0 +1,228 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_TRACE_HPP
+#define SUPREME_TRACE_HPP
+
+#include <xpcc/architecture/platform.hpp>
+#include <system/control_rate.hpp>
+
+/*
+	Trace recorder, samples selected signals of the core into a ring
+	buffer in RAM, every control cycle or every n-th (divider).
+
+	Once armed, the recorder runs continuously until the trigger fires,
+	either by the host (command trigger) or by the trigger channel
+	crossing the level in the selected direction. After the trigger it
+	records until the buffer holds the requested number of pre-trigger
+	samples followed by the post-trigger samples, then it stops (done).
+	If the trigger fires before enough samples were recorded, the post-
+	trigger part is longer.
+
+	The host reads the buffer in chunks, oldest sample first. A sample
+	consists of one word per selected channel, in the order of the
+	channel bits. Position and current are unsigned, velocity and pwm
+	signed, the pwm is negative for direction 0.
+
+	The velocity is the difference of the positions of consecutive control
+	cycles, in position units per ms, independent of the divider and of
+	the velocity polled by the host. It is 0 for the first cycle after
+	arming and not recorded by default.
+*/
+
+namespace supreme {
+namespace trace {
+
+	enum channel_t {
+		position = 0x01,
+		current  = 0x02,
+		velocity = 0x04,
+		pwm      = 0x08,
+	};
+	const uint8_t num_channels = 4;
+	const uint8_t all_channels = 0x0F;
+	const uint8_t default_channels = position | current | pwm;
+	const uint8_t default_words = 3;
+
+	enum state_t {
+		stopped   = 0,
+		armed     = 1, /* recording, waiting for the trigger */
+		triggered = 2, /* recording the post-trigger samples */
+		done      = 3,
+	};
+
+	/* written to the state register */
+	enum command_t {
+		stop    = 0,
+		arm     = 1,
+		trigger = 2, /* manual trigger, while armed */
+	};
+
+	enum trigger_mode_t {
+		manual  = 0, /* by command only */
+		rising  = 1, /* trigger channel rises to or above level */
+		falling = 2, /* trigger channel falls to or below level */
+		num_modes
+	};
+
+	const uint16_t buffer_words = 256;
+
+	class trace_recorder {
+		uint16_t buffer[buffer_words];
+
+		uint8_t  state = stopped;
+		uint8_t  channels = default_channels;
+		uint8_t  words = default_words;     /* per sample */
+		uint16_t capacity = buffer_words / default_words; /* samples */
+		uint8_t  divider = 1;
+		uint8_t  div_count = 0;
+
+		uint8_t  trigger_mode = manual;
+		uint8_t  trigger_channel = 0;       /* channel index */
+		uint16_t level = 0;
+		uint16_t pre_trigger = 0;
+		bool     forced = false;
+		bool     has_last = false;
+		int32_t  last = 0;
+		bool     has_position = false;
+		uint16_t last_position = 0;
+
+		uint16_t head = 0;                  /* next sample written */
+		uint16_t count = 0;                 /* samples in buffer */
+		uint16_t post = 0;                  /* samples left after trigger */
+		uint16_t trigger_pos = 0;
+
+	public:
+
+		template <typename CoreType>
+		void record(CoreType const& ux) {
+			if (state != armed and state != triggered) return;
+
+			/* sampled every cycle, hence before the divider */
+			const uint16_t p = ux.get_position();
+			const int16_t dp = has_position ? (int16_t) (p - last_position) : 0;
+			last_position = p;
+			has_position = true;
+
+			if (++div_count < divider) return;
+			div_count = 0;
+
+			const uint8_t used = channels | (1 << trigger_channel);
+			uint16_t v[num_channels] = { 0, 0, 0, 0 };
+			if (used & position) v[0] = p;
+			if (used & current ) v[1] = ux.get_current();
+			if (used & velocity) v[2] = per_ms(dp);
+			if (used & pwm     ) v[3] = ux.get_target_dir() ? ux.get_target_pwm() : -ux.get_target_pwm();
+
+			if (state == armed and check_trigger(v)) {
+				trigger_pos = (count < pre_trigger) ? count : pre_trigger;
+				post = capacity - trigger_pos;
+				state = triggered;
+			}
+
+			uint16_t* s = &buffer[head * words];
+			for (uint8_t c = 0; c < num_channels; ++c)
+				if (channels & (1 << c)) *s++ = v[c];
+			if (++head == capacity) head = 0;
+			if (count < capacity) ++count;
+
+			if (state == triggered and --post == 0) state = done;
+		}
+
+		void command(uint8_t c) {
+			switch(c)
+			{
+				case stop   : if (state != done) state = stopped; break;
+				case arm    : restart(); break;
+				case trigger: forced = true; break;
+				default: break;
+			}
+		}
+
+		/* changing the channels discards the recording */
+		void set_channels(uint8_t mask) {
+			mask &= all_channels;
+			channels = mask ? mask : (uint8_t) position;
+			words = 0;
+			for (uint8_t m = channels; m; m >>= 1) words += m & 0x1;
+			capacity = buffer_words / words;
+			set_pre_trigger(pre_trigger);
+			state = stopped;
+			count = 0;
+			head = 0;
+		}
+
+		void set_divider        (uint8_t d)  { divider = d ? d : 1; }
+		void set_trigger_mode   (uint8_t m)  { trigger_mode = (m < num_modes) ? m : (uint8_t) manual; }
+		void set_trigger_channel(uint8_t c)  { trigger_channel = (c < num_channels) ? c : 0; }
+		void set_level          (uint16_t l) { level = l; }
+		void set_pre_trigger    (uint16_t n) { pre_trigger = (n < capacity) ? n : capacity - 1; }
+
+		uint8_t  get_state          (void) const { return state; }
+		uint8_t  get_channels       (void) const { return channels; }
+		uint8_t  get_divider        (void) const { return divider; }
+		uint8_t  get_trigger_mode   (void) const { return trigger_mode; }
+		uint8_t  get_trigger_channel(void) const { return trigger_channel; }
+		uint16_t get_level          (void) const { return level; }
+		uint16_t get_pre_trigger    (void) const { return pre_trigger; }
+		uint16_t get_samples        (void) const { return count; }
+		uint16_t get_trigger_pos    (void) const { return trigger_pos; }
+		uint16_t get_capacity       (void) const { return capacity; }
+
+		/* byte of the recording, oldest sample first, msb first,
+		   bytes beyond the recorded samples are read as zero */
+		uint8_t get_byte(uint16_t offset) const {
+			const uint16_t sample = offset / (2 * words);
+			if (sample >= count) return 0;
+			uint16_t i = head + capacity - count + sample;
+			if (i >= capacity) i -= capacity;
+			const uint16_t w = buffer[i * words + (offset / 2) % words];
+			return (offset & 0x1) ? w & 0xff : w >> 8;
+		}
+
+	private:
+		void restart(void) {
+			head = 0;
+			count = 0;
+			div_count = divider - 1; /* record at once */
+			trigger_pos = 0;
+			forced = false;
+			has_last = false;
+			has_position = false;
+			state = armed;
+		}
+
+		/* position difference of one control cycle to units per ms */
+		static int16_t per_ms(int16_t dp) {
+			if (control_rate::hz == 1000) return dp;
+			return ((int32_t) dp << 8) / control_rate::scale_x256;
+		}
+
+		/* position and current are unsigned, velocity and pwm signed */
+		int32_t value(uint16_t raw) const {
+			return (trigger_channel < 2) ? (int32_t) raw : (int32_t) (int16_t) raw;
+		}
+
+		bool check_trigger(const uint16_t* v) {
+			const int32_t x = value(v[trigger_channel]);
+			const int32_t l = value(level);
+			bool hit = forced;
+			if (has_last and trigger_mode == rising ) hit |= (last < l and x >= l);
+			if (has_last and trigger_mode == falling) hit |= (last > l and x <= l);
+			last = x;
+			has_last = true;
+			return hit;
+		}
+	};
+
+	extern trace_recorder recorder; /* defined in main.cpp */
+
+} /* namespace trace */
+} /* namespace supreme */
+
+#endif /* SUPREME_TRACE_HPP */
@@ -0,0 +1,46 @@
+/*---------------------------------+
+ | Supreme Machines                |
+ | Sensorimotor Firmware           |
+ | Matthias Kubisch                |
+ | kubisch@informatik.hu-berlin.de |
+ | November 2018                   |
+ +---------------------------------*/
+
+#ifndef SUPREME_TRANSMIT_HPP
+#define SUPREME_TRANSMIT_HPP
+
+#include <avr/io.h>
+#include <xpcc/architecture/platform.hpp>
+
+/*
+	Transmission of responses straight from the send buffer.
+
+	Uart0::write() copies every byte into the xpcc TX ring, which is
+	then drained by the data register empty interrupt. Responses are
+	sent blocking anyway, so the bytes are fed to UDR0 directly from the
+	prepared message. The first byte is on the wire right after the
+	driver was enabled and the TX ring is not used for responses at all.
+	The data register empty interrupt stays disabled as long as nothing
+	is written through Uart0.
+*/
+
+namespace supreme {
+namespace uart {
+
+	inline void transmit(const uint8_t* data, uint16_t len) {
+		/* clear transmit complete by writing a one, keep the writable
+		   config bits, flags written as zero are left untouched */
+		UCSR0A = (UCSR0A & (1<<U2X0 | 1<<MPCM0)) | (1<<TXC0);
+		for (uint16_t i = 0; i < len; ++i) {
+			while (!(UCSR0A & (1<<UDRE0)));
+			UDR0 = data[i];
+		}
+		/* wait until the last stop bit left the shift register,
+		   before the caller disables the driver */
+		while (!(UCSR0A & (1<<TXC0)));
+	}
+
+} /* namespace uart */
+} /* namespace supreme */
+
+#endif /* SUPREME_TRANSMIT_HPP */
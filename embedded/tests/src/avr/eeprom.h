@@ -3,20 +3,26 @@
 
 typedef unsigned char uint8_t;
 
-uint8_t motor_id = 23; //TODO make array
+struct eeprom_mock {
+	uint8_t memory[1024];
+	eeprom_mock() {
+		for (auto& m : memory) m = 0xff; /* erased */
+		memory[23] = 23; /* motor id */
+	}
+};
 
+extern eeprom_mock eeprom; /* see test_globals.cpp */
 
-void eeprom_busy_wait(void) {}
+inline void eeprom_busy_wait(void) {}
 
-uint8_t eeprom_read_byte(uint8_t* ) {
-//	printf("rd motor id: %u\n", motor_id & 0x7F);
-	return motor_id;
+inline uint8_t eeprom_read_byte(uint8_t* addr) {
+//	printf("rd eeprom[%lu]: %u\n", (unsigned long) addr, eeprom.memory[(unsigned long) addr]);
+	return eeprom.memory[(unsigned long) addr];
 }
 
-void eeprom_write_byte(uint8_t*, uint8_t b) {
-	motor_id = b;
-//	printf("wr motor id: %u\n", motor_id & 0x7F);
+inline void eeprom_write_byte(uint8_t* addr, uint8_t b) {
+	eeprom.memory[(unsigned long) addr] = b;
+//	printf("wr eeprom[%lu]: %u\n", (unsigned long) addr, b);
 }
 
-void set_motor_id(uint8_t id) { motor_id = id; }
-
+inline void set_motor_id(uint8_t id) { eeprom.memory[23] = id; }
@@ -0,0 +1,4 @@
+/* timer 0 registers are ordinary variables on the host */
+
+extern uint8_t TCNT0;
+extern uint8_t OCR0A;
@@ -0,0 +1,7 @@
+
+/* program memory is ordinary memory on the host */
+
+#define PROGMEM
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
@@ -3,20 +3,13 @@
 #include "./catch_1.10.0.hpp"
 
 #include <test_sensorimotor_core.hpp>
+#include <test_communication.hpp>
+#include <system/timer.hpp>
+#include <system/baudrate.hpp>
 
 namespace supreme {
 namespace local_tests {
 
-
-template <typename T>
-bool verify_checksum(T const& data) {
-	uint8_t sum = 0;
-	for (auto const& d : data)
-		sum += d;
-	return sum == 0;
-}
-
-
 TEST_CASE( "sendbuffer is filled and flushed", "[communication]")
 {
 	reset_hardware();
@@ -207,16 +200,6 @@ TEST_CASE( "data request command can be received and is responded", "[communicat
 	REQUIRE( verify_checksum(Uart0::recv_buffer) );
 }
 
-void send(std::vector<uint8_t> buf) {
-	Uart0::send_queue.push(0xff);
-	Uart0::send_queue.push(0xff);
-	uint8_t chksum = 0xfe;
-	for (auto& b : buf) {
-		chksum += b;
-		Uart0::send_queue.push(b);
-	}
-	Uart0::send_queue.push(~chksum + 1);
-}
 
 TEST_CASE( "valid commands and responses for other motors is ignored", "[communication]")
 {
@@ -657,8 +640,6 @@ TEST_CASE( "set_voltage command can be received, pwm and direction is set and co
 	REQUIRE( Uart0::buffer_flushed );
 }
 
-int16_t get_signed_word(uint8_t hi, uint8_t lo) { return (hi << 8) | lo; }
-
 TEST_CASE( "ext_sensor_request command can be received and is responded with data", "[communication]")
 {
 	reset_hardware();
@@ -710,4 +691,1398 @@ TEST_CASE( "ext_sensor_request command can be received and is responded with dat
 	REQUIRE( Uart0::buffer_flushed );
 }
 
+TEST_CASE( "set_voltage_all broadcast applies own entry and is NOT responded", "[communication]")
+{
+	reset_hardware();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	REQUIRE( com.get_motor_id() == 23 );
+
+	/* entries of (D|ID, PWM) */
+	std::vector<uint8_t> sync_write = { 0xB8, /*entries=*/3, 42, 17, 0x80|23, 64, 7, 99 };
+
+	send(sync_write);
+	com.step();
+
+	REQUIRE( ux.voltage_pwm == 64 );
+	REQUIRE( ux.direction == true );
+	REQUIRE( ux.enabled );
+
+	REQUIRE( Uart0::send_queue.empty() );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+	REQUIRE( not Uart0::buffer_flushed );
+
+	/* still responds to commands afterwards */
+	send({ 0xe0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+}
+
+TEST_CASE( "set_voltage_all broadcast without own entry or with wrong checksum is not applied", "[communication]")
+{
+	reset_hardware();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* pwm value of the other entry looks like own id */
+	send({ 0xB8, /*entries=*/2, 42, 23, 0x80|7, 99 });
+	send({ 0xB8, /*entries=*/0 });
+	com.step();
+
+	REQUIRE( ux.voltage_pwm == 0 );
+	REQUIRE( not ux.enabled );
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+
+	for (uint8_t b : { 0xff, 0xff, 0xB8, 1, 23, 64, /*invalid checksum*/0x00 })
+		Uart0::send_queue.push(b);
+	com.step();
+
+	REQUIRE( ux.voltage_pwm == 0 );
+	REQUIRE( not ux.enabled );
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+}
+
+TEST_CASE( "data_requested_all broadcast is responded in own time slot", "[communication]")
+{
+	reset_hardware();
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	REQUIRE( com.get_motor_id() == 23 );
+	ux.enable();
+
+	/* 3rd listed motor, slots of 15 bytes, 150us + 40us guard */
+	send({ 0xC8, /*entries=*/4, /*slot size=*/15, 42, 7, 23, 13 });
+	com.step();
+
+	REQUIRE( com.get_state() == com_t::command_state_t::delaying );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* responses of preceding motors are discarded */
+	send({ 0x80, 42, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+	timer::advance_us(2*190 - 2);
+	com.step();
+
+	REQUIRE( Uart0::send_queue.empty() );
+	REQUIRE( com.get_state() == com_t::command_state_t::delaying );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	timer::advance_us(2);
+	com.step();
+
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x80 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+	REQUIRE( Uart0::buffer_flushed );
+
+	/* motor was not stopped by reading */
+	REQUIRE( ux.enabled );
+
+	/* response of the succeeding motor is ignored */
+	reset_hardware();
+	send({ 0x80, 13, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+}
+
+TEST_CASE( "data_requested_all broadcast is responded immediately in first slot and ignored if not listed", "[communication]")
+{
+	reset_hardware();
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	send({ 0xC8, /*entries=*/2, /*slot size=*/0, 42, 7 });
+	com.step();
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	send({ 0xC8, /*entries=*/2, /*slot size=*/0, 23, 7 });
+	com.step();
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+}
+
+TEST_CASE( "commands with crc8 frame check are responded with crc8", "[communication]")
+{
+	reset_hardware();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	send_crc8({ 0xC0, 23 });
+	com.step();
+
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	REQUIRE( Uart0::recv_buffer[0] == 0xff );
+	REQUIRE( Uart0::recv_buffer[1] == 0xfd );
+	REQUIRE( Uart0::recv_buffer[2] == 0x80 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( verify_crc8(Uart0::recv_buffer) );
+
+	/* next request with additive checksum gets back legacy response */
+	reset_hardware();
+	send({ 0xe0, 23 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( Uart0::recv_buffer[1] == 0xff );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+}
+
+TEST_CASE( "crc8 frame check refuses swapped bytes", "[communication]")
+{
+	reset_hardware();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* sync-write entries (23,64),(42,17) with swapped pwm values, same sum */
+	uint8_t crc = 0x2a;
+	for (uint8_t b : { 0xB8, 2, 23, 64, 42, 17 })
+		crc = crc8_update(crc, b);
+
+	for (uint8_t b : { 0xff, 0xfd, 0xB8, 2, 23, 17, 42, 64 })
+		Uart0::send_queue.push(b);
+	Uart0::send_queue.push(crc);
+	com.step();
+
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( ux.voltage_pwm == 0 );
+	REQUIRE( not ux.enabled );
+
+	send_crc8({ 0xB8, 2, 23, 64, 42, 17 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( ux.voltage_pwm == 64 );
+	REQUIRE( ux.enabled );
+}
+
+TEST_CASE( "cut off message is dropped after inter-byte timeout", "[communication]")
+{
+	reset_hardware();
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* set_voltage cut off before pwm value */
+	for (uint8_t b : { 0xff, 0xff, 0xB1, 23 })
+		Uart0::send_queue.push(b);
+	com.step();
+	REQUIRE( com.get_state() == com_t::command_state_t::reading );
+
+	timer::advance_us(98);
+	com.step();
+	REQUIRE( com.get_state() == com_t::command_state_t::reading );
+	REQUIRE( com.get_timeouts() == 0 );
+
+	timer::advance_us(2);
+	com.step();
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( com.get_timeouts() == 1 );
+	REQUIRE( com.get_errors() == 0 );
+
+	/* next message is not misparsed */
+	send({ 0xC0, 23 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.voltage_pwm == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+
+	/* a single sync byte also times out */
+	reset_hardware();
+	Uart0::send_queue.push(0xff);
+	com.step();
+	timer::advance_us(100);
+	com.step();
+	REQUIRE( com.get_timeouts() == 2 );
+	send({ 0xe0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( com.get_errors() == 0 );
+}
+
+TEST_CASE( "repeated sync bytes are skipped when hunting for the sync word", "[communication]")
+{
+	reset_hardware();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	Uart0::send_queue.push(0xff);
+	send({ 0xe0, 23 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+
+	reset_hardware();
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	send_crc8({ 0xe0, 23 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( verify_crc8(Uart0::recv_buffer) );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+}
+
+TEST_CASE( "read_registers command is responded with requested window of the control table", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* position and current */
+	send({ 0x50, 23, /*addr=*/0x40, /*len=*/4 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 4 + 1 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x51 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( Uart0::recv_buffer[4] == 4 );
+	REQUIRE( Uart0::recv_buffer[5] == 0x1A );
+	REQUIRE( Uart0::recv_buffer[6] == 0x1B );
+	REQUIRE( Uart0::recv_buffer[7] == 0x2A );
+	REQUIRE( Uart0::recv_buffer[8] == 0x2B );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* starting with low byte of a word, ending with high byte, unmapped bytes are zero */
+	reset_hardware();
+	ux.max_pwm = 77;
+	send({ 0x50, 23, /*addr=*/0x1F, /*len=*/2 });
+	send({ 0x50, 23, /*addr=*/0x4B, /*len=*/3 });
+	send({ 0x50, 23, /*addr=*/0x45, /*len=*/2 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 8 + 9 + 8 );
+	REQUIRE( Uart0::recv_buffer[5] == 0 );
+	REQUIRE( Uart0::recv_buffer[6] == 77 );
+	REQUIRE( Uart0::recv_buffer[8+5] == 0x5B );
+	REQUIRE( Uart0::recv_buffer[8+6] == 0 );
+	REQUIRE( Uart0::recv_buffer[8+7] == 0 );
+	REQUIRE( Uart0::recv_buffer[17+5] == 0x3B );
+	REQUIRE( Uart0::recv_buffer[17+6] == 0x6A );
+
+	/* window too large */
+	reset_hardware();
+	send({ 0x50, 23, /*addr=*/0x00, /*len=*/17 });
+	com.step();
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+}
+
+TEST_CASE( "write_registers command writes writable registers and is NOT responded", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	send({ 0x60, 23, /*addr=*/0x20, /*len=*/1, 99 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.max_pwm == 99 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* read-only registers are not written */
+	send({ 0x60, 23, /*addr=*/0x1F, /*len=*/5, 1, 42, 0, 0x12, 0x34 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.max_pwm == 42 );
+	REQUIRE( com.get_motor_id() == 23 );
+
+	/* id is stored in eeprom */
+	send({ 0x60, 23, /*addr=*/0x00, /*len=*/1, 13 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_motor_id() == 13 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+	set_motor_id(23);
+}
+
+TEST_CASE( "register access for other motors is ignored", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	send({ 0x50, 42, 0x40, 4 });
+	send({ 0x51, 42, 4, 0xff, 0xff, 0x60, 23 });
+	send({ 0x60, 42, 0x20, 3, 0xff, 0xff, 0xC0 });
+	send({ 0x60, 42, 0x20, 0 });
+	send({ 0x51, 42, 0 });
+	send({ 0xe0, 23 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( ux.max_pwm == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( Uart0::recv_buffer[2] == 0xe1 );
+}
+
+TEST_CASE( "data response contains the fields selected by telemetry mask", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+	REQUIRE( com.get_telemetry_mask() == 0x1F );
+
+	/* position and velocity only */
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0x05 });
+	send({ 0xC0, 23 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_telemetry_mask() == 0x05 );
+	REQUIRE( Uart0::recv_buffer.size() == 9 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x92 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( Uart0::recv_buffer[4] == 0x1A ); // position
+	REQUIRE( Uart0::recv_buffer[5] == 0x1B );
+	REQUIRE( Uart0::recv_buffer[6] == 0x3A ); // velocity
+	REQUIRE( Uart0::recv_buffer[7] == 0x3B );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* mask is kept in eeprom */
+	{
+		com_t com2(ux, ex);
+		REQUIRE( com2.get_telemetry_mask() == 0x05 );
+	}
+
+	/* all fields */
+	reset_hardware();
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0xFF });
+	send({ 0xB0, 23, 10 });
+	com.step();
+	REQUIRE( com.get_telemetry_mask() == 0xFF );
+	REQUIRE( Uart0::recv_buffer.size() == 21 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x98 );
+	REQUIRE( Uart0::recv_buffer[14] == 0x6A ); // back emf
+	REQUIRE( Uart0::recv_buffer[15] == 0x6B );
+	REQUIRE( Uart0::recv_buffer[16] == 0x01 ); // status, enabled
+	REQUIRE( Uart0::recv_buffer[18] == 0x7A ); // timestamp
+	REQUIRE( Uart0::recv_buffer[19] == 0x7B );
+
+	/* all fields are kept in eeprom as well */
+	{
+		com_t com2(ux, ex);
+		REQUIRE( com2.get_telemetry_mask() == 0xFF );
+	}
+
+	/* legacy response again */
+	reset_hardware();
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0x1F });
+	send({ 0xC0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x80 );
+	REQUIRE( com.get_errors() == 0 );
+}
+
+TEST_CASE( "data responses of other motors with any telemetry mask are ignored", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	send({ 0x90, 42 });
+	send({ 0x91, 42, 0xff, 0xff });
+	send({ 0x92, 42, 0xff, 0xff, 0xC0, 23 });
+	send({ 0x96, 42, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0xff, 0xff });
+	send({ 0xe0, 23 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( Uart0::recv_buffer[2] == 0xe1 );
+}
+
+TEST_CASE( "default bulk-read slot size follows the telemetry mask", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* position only, 7 bytes per slot: 70us + 40us guard */
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0x01 });
+	send({ 0xC8, /*entries=*/2, /*slot size=*/0, 42, 23 });
+	com.step();
+	REQUIRE( com.get_state() == com_t::command_state_t::delaying );
+
+	timer::advance_us(108);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	timer::advance_us(2);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 7 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x91 );
+	REQUIRE( com.get_errors() == 0 );
+
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0x1F });
+	com.step();
+}
+
+TEST_CASE( "streaming sends data periodically in own slot after sync frame", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* period 2ms, second slot: 15 bytes, 150us + 40us guard */
+	send({ 0x60, 23, /*addr=*/0x02, /*len=*/2, /*period=*/2, /*slot=*/1 });
+	com.step();
+	REQUIRE( not com.is_streaming() );
+
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( com.is_streaming() );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	timer::advance_us(188);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	timer::advance_us(2);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x80 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	Uart0::recv_buffer.clear();
+
+	timer::advance_us(1998);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	timer::advance_us(2);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	Uart0::recv_buffer.clear();
+
+	/* requests are still served in between */
+	timer::advance_us(1000);
+	send({ 0xE0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( Uart0::recv_buffer[2] == 0xE1 );
+	Uart0::recv_buffer.clear();
+
+	/* missed periods are skipped, not sent in a burst */
+	timer::advance_us(5000);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+	Uart0::recv_buffer.clear();
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* writing period zero stops streaming */
+	send({ 0x60, 23, /*addr=*/0x02, /*len=*/1, 0 });
+	com.step();
+	REQUIRE( not com.is_streaming() );
+	timer::advance_us(4000);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+	REQUIRE( com.get_errors() == 0 );
+}
+
+TEST_CASE( "streaming stops when sync frames are missing", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* period 1ms, first slot */
+	send({ 0x60, 23, /*addr=*/0x02, /*len=*/2, /*period=*/1, /*slot=*/0 });
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( com.is_streaming() );
+
+	unsigned frames = 0;
+	for (unsigned i = 0; i < 150; ++i) {
+		com.step();
+		frames += Uart0::recv_buffer.size() / 15;
+		Uart0::recv_buffer.clear();
+		timer::advance_us(1000);
+	}
+	REQUIRE( frames == 100 );
+	REQUIRE( not com.is_streaming() );
+
+	/* next sync restarts */
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( com.is_streaming() );
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+}
+
+TEST_CASE( "batch command executes sub-commands and is responded with one frame", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* set_voltage, set_pwm_limit, ext_sensor_request */
+	send({ 0x30, 23, /*len=*/6, 0xB1, 42, 0xA0, 99, 0x40, 0x01 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( ux.enabled );
+	REQUIRE( ux.voltage_pwm == 42 );
+	REQUIRE( ux.direction );
+	REQUIRE( ux.max_pwm == 99 );
+	REQUIRE( ex.ext_sensor_requests == 1 );
+
+	/* header, data response (11), sensor response (7), checksum */
+	REQUIRE( Uart0::recv_buffer.size() == 5 + 11 + 7 + 1 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x31 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( Uart0::recv_buffer[4] == 18 );
+	REQUIRE( Uart0::recv_buffer[5] == 0x80 );
+	REQUIRE( Uart0::recv_buffer[6] == 0x1A );
+	REQUIRE( Uart0::recv_buffer[15] == 0x5B );
+	REQUIRE( Uart0::recv_buffer[16] == 0x41 );
+	REQUIRE( get_signed_word( Uart0::recv_buffer[17]
+	                        , Uart0::recv_buffer[18] ) == -1337 );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* register access and ping */
+	reset_hardware();
+	send({ 0x30, 23, /*len=*/9, 0x60, 0x20, 1, 55, 0x50, 0x20, 1, 0xE0, 0xD0 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.max_pwm == 55 );
+	REQUIRE( Uart0::recv_buffer.size() == 5 + 3 + 1 + 1 );
+	REQUIRE( Uart0::recv_buffer[4] == 4 );
+	REQUIRE( Uart0::recv_buffer[5] == 0x51 );
+	REQUIRE( Uart0::recv_buffer[6] == 1 );
+	REQUIRE( Uart0::recv_buffer[7] == 55 );
+	REQUIRE( Uart0::recv_buffer[8] == 0xE1 );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+}
+
+TEST_CASE( "invalid batch command is refused without executing any sub-command", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* set_id is not allowed */
+	send({ 0x30, 23, /*len=*/4, 0xA0, 99, 0x70, 5 });
+	com.step();
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( ux.max_pwm == 0 );
+	REQUIRE( com.get_motor_id() == 23 );
+
+	/* truncated sub-command */
+	send({ 0x30, 23, /*len=*/3, 0xA0, 99, 0xB0 });
+	com.step();
+	REQUIRE( com.get_errors() == 2 );
+	REQUIRE( ux.max_pwm == 0 );
+
+	/* response exceeds send buffer */
+	send({ 0x30, 23, /*len=*/4, 0xC0, 0xC0, 0xC0, 0xC0 });
+	com.step();
+	REQUIRE( com.get_errors() == 3 );
+
+	/* batch too long */
+	send({ 0x30, 23, /*len=*/25 });
+	com.step();
+	REQUIRE( com.get_errors() == 4 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* 20 responses of 13 bytes, would wrap around 8 bit */
+	std::vector<uint8_t> many = { 0x30, 23, /*len=*/20 };
+	for (unsigned i = 0; i < 20; ++i) many.push_back(0xC0);
+	send(many);
+	com.step();
+	REQUIRE( com.get_errors() == 5 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* write length beyond the access limit, would wrap the sub-command size */
+	ux.max_pwm = 7;
+	send({ 0x30, 23, /*len=*/3, 0x60, 0x20, 0xFE });
+	com.step();
+	REQUIRE( com.get_errors() == 6 );
+	REQUIRE( ux.max_pwm == 7 );
+	send({ 0x30, 23, /*len=*/5, 0x60, 0x20, 0x11, 1, 2 });
+	com.step();
+	REQUIRE( com.get_errors() == 7 );
+	REQUIRE( ux.max_pwm == 7 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+}
+
+TEST_CASE( "batch commands and responses for other motors are ignored", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	send({ 0x30, 42, /*len=*/3, 0xB0, 0xff, 0xE0 });
+	send({ 0x31, 42, /*len=*/3, 0xE1, 0xff, 0xff });
+	send({ 0xE0, 23 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( not ux.enabled );
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( Uart0::recv_buffer[2] == 0xE1 );
+}
+
+TEST_CASE( "set_baudrate_all broadcast switches baud rate and falls back without valid frames", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+	uart::mock_baudrate = uart::baud_1M;
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+	REQUIRE( com.get_baudrate() == uart::baud_1M );
+
+	send({ 0xF8, uart::baud_2M });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+	REQUIRE( com.get_baudrate() == uart::baud_2M );
+	REQUIRE( uart::mock_baudrate == uart::baud_2M );
+
+	/* no valid frame within 500ms */
+	for (unsigned i = 0; i < 499; ++i) {
+		timer::advance_us(1000);
+		com.step();
+	}
+	REQUIRE( uart::mock_baudrate == uart::baud_2M );
+	timer::advance_us(1000);
+	com.step();
+	REQUIRE( com.get_baudrate() == uart::baud_1M );
+	REQUIRE( uart::mock_baudrate == uart::baud_1M );
+
+	/* a valid frame confirms the new rate */
+	send({ 0xF8, uart::baud_2M });
+	com.step();
+	timer::advance_us(10000);
+	send({ 0xE0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	for (unsigned i = 0; i < 1000; ++i) {
+		timer::advance_us(1000);
+		com.step();
+	}
+	REQUIRE( com.get_baudrate() == uart::baud_2M );
+	REQUIRE( uart::mock_baudrate == uart::baud_2M );
+	REQUIRE( eeprom.memory[25] == 0xff ); /* not persisted */
+
+	/* slot times shrink with the byte time, 15 bytes: 75us + 40us guard */
+	reset_hardware();
+	send({ 0xC8, /*entries=*/2, /*slot size=*/0, 42, 23 });
+	com.step();
+	timer::advance_us(112);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+	timer::advance_us(4);
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 15 );
+
+	/* unsupported rate */
+	send({ 0xF8, 0x05 });
+	com.step();
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( com.get_baudrate() == uart::baud_2M );
+
+	send({ 0xF8, uart::baud_1M });
+	com.step();
+	REQUIRE( uart::mock_baudrate == uart::baud_1M );
+}
+
+TEST_CASE( "baud rate is persisted after confirmation and restored on startup", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+	uart::mock_baudrate = uart::baud_1M;
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	{
+		com_t com(ux, ex);
+		send({ 0xF8, 0x80 | uart::baud_2M });
+		com.step();
+		REQUIRE( eeprom.memory[25] == 0xff );
+
+		send({ 0x50, 23, /*addr=*/0x04, /*len=*/1 });
+		com.step();
+		REQUIRE( Uart0::recv_buffer.size() == 7 );
+		REQUIRE( Uart0::recv_buffer[5] == uart::baud_2M );
+		REQUIRE( eeprom.memory[25] == uart::baud_2M );
+	}
+
+	/* restored, but falls back if the host does not use it */
+	uart::mock_baudrate = uart::baud_1M;
+	{
+		com_t com(ux, ex);
+		REQUIRE( com.get_baudrate() == uart::baud_2M );
+		REQUIRE( uart::mock_baudrate == uart::baud_2M );
+		for (unsigned i = 0; i < 500; ++i) {
+			timer::advance_us(1000);
+			com.step();
+		}
+		REQUIRE( com.get_baudrate() == uart::baud_1M );
+
+		/* persisting 1 Mbaud is applied at once */
+		send({ 0xF8, 0x80 | uart::baud_1M });
+		com.step();
+		REQUIRE( eeprom.memory[25] == uart::baud_1M );
+	}
+	eeprom.memory[25] = 0xff;
+}
+
+TEST_CASE( "capabilities request is responded with version, features and limits", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* responses of others are ignored */
+	send({ 0x10, 42 });
+	send({ 0x11, 42, /*len=*/3, 0xff, 0xff, 0xff });
+	send({ 0x10, 23 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_state() == com_t::command_state_t::syncing );
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 11 + 1 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x11 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( Uart0::recv_buffer[4] == 11 );
+	REQUIRE( Uart0::recv_buffer[5] == capabilities::version_major );
+	REQUIRE( Uart0::recv_buffer[6] == capabilities::version_minor );
+	REQUIRE( ((Uart0::recv_buffer[7] << 8) | Uart0::recv_buffer[8]) == capabilities::features );
+	REQUIRE( Uart0::recv_buffer[9] == 24 );
+	REQUIRE( Uart0::recv_buffer[10] == 16 );
+	REQUIRE( Uart0::recv_buffer[11] == 40 );
+	REQUIRE( Uart0::recv_buffer[12] == 60 );
+	REQUIRE( Uart0::recv_buffer[13] == 4 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[14], Uart0::recv_buffer[15]) == 1000 ); // Hz
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+}
+
+TEST_CASE( "group addressed commands are applied by members and NOT responded", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* join groups 0x81 and 0x85 */
+	send({ 0x60, 23, /*addr=*/0x08, /*len=*/2, 0x81, 0x85 });
+	com.step();
+	REQUIRE( eeprom.memory[26] == 0x81 );
+	REQUIRE( eeprom.memory[27] == 0x85 );
+
+	send({ 0xA0, 0x85, 77 });
+	send({ 0xB1, 0x81, 42 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.max_pwm == 77 );
+	REQUIRE( ux.voltage_pwm == 42 );
+	REQUIRE( ux.enabled );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* all motors */
+	send({ 0xC0, 0xFF });
+	send({ 0x30, 0xFF, /*len=*/2, 0xA0, 66 });
+	com.step();
+	REQUIRE( not ux.enabled );
+	REQUIRE( ux.max_pwm == 66 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* other groups are ignored, set_id is never group addressed */
+	send({ 0xA0, 0x82, 11 });
+	send({ 0x60, 0x82, /*addr=*/0x20, /*len=*/1, 12 });
+	send({ 0x70, 0xFF, 5 });
+	send({ 0x60, 0xFF, /*addr=*/0x00, /*len=*/1, 5 });
+	send({ 0x30, 0xFF, /*len=*/4, 0x60, 0x00, 1, 5 });
+	send({ 0xE0, 23 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.max_pwm == 66 );
+	REQUIRE( com.get_motor_id() == 23 );
+	REQUIRE( eeprom.memory[23] == 23 ); /* not written */
+	REQUIRE( Uart0::recv_buffer.size() == 5 );
+	REQUIRE( Uart0::recv_buffer[2] == 0xE1 );
+
+	/* memberships are restored on startup, 0 leaves a group */
+	{
+		com_t com2(ux, ex);
+		send({ 0x50, 23, /*addr=*/0x08, /*len=*/4 });
+		send({ 0x60, 23, /*addr=*/0x08, /*len=*/2, 0, 0 });
+		com2.step();
+		REQUIRE( Uart0::recv_buffer.size() == 5 + 10 );
+		REQUIRE( Uart0::recv_buffer[5+5] == 0x81 );
+		REQUIRE( Uart0::recv_buffer[5+6] == 0x85 );
+		REQUIRE( Uart0::recv_buffer[5+7] == 0 );
+		REQUIRE( Uart0::recv_buffer[5+8] == 0 );
+
+		send({ 0xA0, 0x81, 11 });
+		com2.step();
+		REQUIRE( ux.max_pwm == 66 );
+	}
+	REQUIRE( eeprom.memory[26] == 0 );
+	REQUIRE( eeprom.memory[27] == 0 );
+	eeprom.memory[26] = eeprom.memory[27] = 0xff;
+}
+
+TEST_CASE( "data response reports status and latched faults", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* status is opt-in, the response becomes 0x96 */
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, telemetry::legacy | telemetry::status });
+	com.step();
+
+	/* invalid checksum and cut off message */
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xe0);
+	Uart0::send_queue.push(23);
+	Uart0::send_queue.push(0x00);
+	com.step();
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xb0);
+	com.step();
+	timer::advance_us(100);
+	com.step();
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( com.get_timeouts() == 1 );
+
+	ux.faults = fault::pwm_limited;
+	send({ 0xB1, 23, 10 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 17 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x96 );
+	REQUIRE( Uart0::recv_buffer[14] == (status::enabled | status::direction) );
+	REQUIRE( Uart0::recv_buffer[15] == (fault::pwm_limited | fault::com_error | fault::com_timeout) );
+
+	/* faults are cleared once reported */
+	reset_hardware();
+	send({ 0x50, 23, /*addr=*/0x4C, /*len=*/2 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 8 );
+	REQUIRE( Uart0::recv_buffer[5] == (status::enabled | status::direction) );
+	REQUIRE( Uart0::recv_buffer[6] == 0 );
+
+	/* group addressed requests keep faults latched */
+	reset_hardware();
+	ux.faults = fault::watchcat;
+	send({ 0xC0, 0xFF });
+	send({ 0x50, 0xFF, /*addr=*/0x4C, /*len=*/2 });
+	send({ 0x30, 0xFF, /*len=*/3, 0x50, 0x4C, 2 });
+	send({ 0xC0, 23 });
+	com.step();
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( Uart0::recv_buffer.size() == 17 );
+	REQUIRE( Uart0::recv_buffer[14] == status::direction ); /* stopped */
+	REQUIRE( Uart0::recv_buffer[15] == fault::watchcat );
+
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, telemetry::legacy });
+	com.step();
+}
+
+TEST_CASE( "data response contains tick stamp and epoch is set by group write", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* position and tick stamp */
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0x81 });
+	send({ 0xC0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 9 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x92 );
+	REQUIRE( Uart0::recv_buffer[4] == 0x1A );
+	REQUIRE( Uart0::recv_buffer[6] == 0x7A );
+	REQUIRE( Uart0::recv_buffer[7] == 0x7B );
+
+	/* epoch written to all motors at once */
+	reset_hardware();
+	ux.ticks = 999;
+	send({ 0x60, 0xFF, /*addr=*/0x06, /*len=*/2, 0x12, 0x34 });
+	com.step();
+	REQUIRE( ux.ticks == 0x1234 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	send({ 0x50, 23, /*addr=*/0x06, /*len=*/2 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer[5] == 0x12 );
+	REQUIRE( Uart0::recv_buffer[6] == 0x34 );
+
+	send({ 0x60, 23, /*addr=*/0x01, /*len=*/1, 0x1F });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+}
+
+TEST_CASE( "diagnostics request is responded with bus counters, optionally resetting them", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	/* wrong checksum */
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xe0);
+	Uart0::send_queue.push(23);
+	Uart0::send_queue.push(0x00);
+	/* unknown command */
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0x01);
+	/* two messages for other motors */
+	send({ 0xe0, 42 });
+	send({ 0xe1, 42 });
+	/* one response */
+	send({ 0xe0, 23 });
+	com.step();
+	/* cut off */
+	Uart0::send_queue.push(0xff);
+	com.step();
+	timer::advance_us(100);
+	Uart0::error_flags = 0x08;
+	com.step();
+	ux.watchcat_trips = 3;
+
+	reset_hardware();
+	send({ 0x20, 23, /*reset=*/0 });
+	com.step();
+
+	const unsigned len = 2 * 8;
+	REQUIRE( Uart0::recv_buffer.size() == 5 + 1 + len );
+	REQUIRE( Uart0::recv_buffer[2] == 0x21 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( Uart0::recv_buffer[4] == len );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 5], Uart0::recv_buffer[ 6]) == 1 ); // checksum
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 7], Uart0::recv_buffer[ 8]) == 1 ); // unknown
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 9], Uart0::recv_buffer[10]) == 1 ); // timeouts
+	REQUIRE( get_signed_word(Uart0::recv_buffer[11], Uart0::recv_buffer[12]) == 2 ); // eaten
+	REQUIRE( get_signed_word(Uart0::recv_buffer[13], Uart0::recv_buffer[14]) == 1 ); // rx errors
+	REQUIRE( get_signed_word(Uart0::recv_buffer[15], Uart0::recv_buffer[16]) == 1 ); // sent
+	REQUIRE( get_signed_word(Uart0::recv_buffer[17], Uart0::recv_buffer[18]) == 3 ); // watchcat
+	REQUIRE( get_signed_word(Uart0::recv_buffer[19], Uart0::recv_buffer[20]) == 2 ); // errors
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* read and reset */
+	reset_hardware();
+	send({ 0x20, 23, /*reset=*/1 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 5 + 1 + len );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[15], Uart0::recv_buffer[16]) == 2 ); // sent
+	REQUIRE( com.get_diagnostics().responses_sent == 1 ); /* this response */
+	REQUIRE( com.get_diagnostics().checksum_errors == 0 );
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( ux.watchcat_trips == 0 );
+
+	/* diagnostics of others are ignored */
+	reset_hardware();
+	send({ 0x20, 42, 1 });
+	send({ 0x21, 42, /*len=*/2, 0, 0 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.get_diagnostics().frames_eaten == 2 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+}
+
+TEST_CASE( "sync frame aligns the control cycle and reports the phase offset", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	clock_sync::clock.set_mode(clock_sync::phase);
+	while (clock_sync::clock.next_compare() != 249); /* settle */
+
+	/* tick was 10 increments early, next cycles are lengthened */
+	TCNT0 = 10;
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	send({ 0x50, 23, /*addr=*/0x0C, /*len=*/4 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 4 + 1 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[5], Uart0::recv_buffer[6]) == 40 ); // us
+	REQUIRE( get_signed_word(Uart0::recv_buffer[7], Uart0::recv_buffer[8]) ==  0 ); // no trim
+
+	REQUIRE( clock_sync::clock.next_compare() == 253 ); /* limited by 8 bit */
+	REQUIRE( clock_sync::clock.next_compare() == 253 );
+	REQUIRE( clock_sync::clock.next_compare() == 251 );
+	REQUIRE( clock_sync::clock.next_compare() == 249 );
+
+	/* tick is due in 10 increments, next cycle is shortened */
+	reset_hardware();
+	TCNT0 = 240;
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( clock_sync::clock.get_offset_us() == -40 );
+	REQUIRE( clock_sync::clock.next_compare() == 239 );
+	REQUIRE( clock_sync::clock.next_compare() == 249 );
+
+	/* phase is taken at the final byte of the frame */
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xF0);
+	TCNT0 = 100;
+	com.step();
+	Uart0::send_queue.push(0x12); /* checksum */
+	TCNT0 = 5;
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( clock_sync::clock.get_offset_us() == 20 );
+	while (clock_sync::clock.next_compare() != 249); /* settle */
+
+	/* frequency trim, clock is 20 increments fast in 100 cycles */
+	send({ 0x60, 23, /*addr=*/0x05, /*len=*/1, clock_sync::frequency });
+	com.step();
+	REQUIRE( clock_sync::clock.get_mode() == clock_sync::frequency );
+	TCNT0 = 0;
+	ux.ticks = 1000;
+	send({ 0xF0 });
+	com.step();
+	TCNT0 = 20;
+	ux.ticks = 1100;
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( clock_sync::clock.get_trim() == 25 ); /* 1/256 increments per cycle, half the drift */
+
+	/* off */
+	clock_sync::clock.set_mode(clock_sync::off);
+	TCNT0 = 30;
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( clock_sync::clock.get_offset_us() == 120 );
+	REQUIRE( clock_sync::clock.next_compare() == 249 );
+
+	clock_sync::clock.set_mode(clock_sync::phase);
+	TCNT0 = 0;
+}
+
+TEST_CASE( "communication is idle only between messages and when not streaming", "[communication]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+	timing::loop.reset();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	com.step();
+	REQUIRE( com.is_idle() );
+
+	/* within a message, the inter-byte timeout is polled */
+	Uart0::send_queue.push(0xff);
+	com.step();
+	REQUIRE( not com.is_idle() );
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xe0);
+	com.step();
+	REQUIRE( not com.is_idle() );
+	Uart0::send_queue.push(23);
+	Uart0::send_queue.push(0x100 - ((0xff + 0xff + 0xe0 + 23) & 0xff));
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( com.is_idle() );
+
+	/* wake latency is reported */
+	timing::loop.tick();
+	timer::advance_us(6);
+	timing::loop.woken(true);
+	timing::loop.woken(false);
+
+	reset_hardware();
+	send({ 0x50, 23, /*addr=*/0xA0, /*len=*/4 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 4 + 1 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[5], Uart0::recv_buffer[6]) == 6 ); // us
+	REQUIRE( get_signed_word(Uart0::recv_buffer[7], Uart0::recv_buffer[8]) == 2 ); // sleeps
+
+	/* streaming waits for its deadlines */
+	send({ 0x60, 23, /*addr=*/0x02, /*len=*/1, 10 });
+	send({ 0xF0 });
+	com.step();
+	REQUIRE( com.is_streaming() );
+	REQUIRE( not com.is_idle() );
+
+	send({ 0x60, 23, /*addr=*/0x02, /*len=*/1, 0 });
+	com.step();
+	REQUIRE( com.is_idle() );
+}
+
+TEST_CASE( "watchcat timeout and stop mode are kept in EEPROM, safe stop is reported", "[communication]")
+{
+	/* see stop::mode_t of the core */
+	const uint8_t stop_mode_coast = 0;
+	const uint8_t stop_mode_ramp  = 1;
+
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	{
+		com_t com(ux, ex);
+
+		/* erased EEPROM selects defaults */
+		REQUIRE( ux.get_watchcat_timeout() == 10 );
+		REQUIRE( ux.get_stop_mode() == stop_mode_coast );
+
+		send({ 0x60, 23, /*addr=*/0x10, /*len=*/2, /*500ms=*/50, stop_mode_ramp });
+		send({ 0x60, 23, /*addr=*/0x21, /*len=*/1, (uint8_t) -4 });
+		com.step();
+		REQUIRE( com.get_errors() == 0 );
+		REQUIRE( ux.get_watchcat_timeout() == 50 );
+		REQUIRE( ux.get_stop_mode() == stop_mode_ramp );
+		REQUIRE( ux.get_hold_gain() == -4 );
+
+		reset_hardware();
+		send({ 0x50, 23, /*addr=*/0x10, /*len=*/2 });
+		send({ 0x50, 23, /*addr=*/0x21, /*len=*/1 });
+		com.step();
+		REQUIRE( Uart0::recv_buffer.size() == 2 * (2 + 3 + 1) + 2 + 1 );
+		REQUIRE( Uart0::recv_buffer[5] == 50 );
+		REQUIRE( Uart0::recv_buffer[6] == stop_mode_ramp );
+		REQUIRE( Uart0::recv_buffer[13] == 0xFC );
+
+		/* safe stop after watchcat trip */
+		ux.stopping = true;
+		reset_hardware();
+		send({ 0x50, 23, /*addr=*/0x4C, /*len=*/2 });
+		com.step();
+		REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 2 + 1 );
+		REQUIRE( (Uart0::recv_buffer[5] & status::stopping) != 0 );
+		ux.stopping = false;
+	}
+
+	/* settings survive a reset */
+	core_t ux2;
+	com_t com2(ux2, ex);
+	REQUIRE( ux2.get_watchcat_timeout() == 50 );
+	REQUIRE( ux2.get_stop_mode() == stop_mode_ramp );
+	REQUIRE( ux2.get_hold_gain() == 0 ); /* RAM */
+
+	eeprom.memory[30] = 0xff;
+	eeprom.memory[31] = 0xff;
+}
+
 }} /* namespace supreme::local_tests */
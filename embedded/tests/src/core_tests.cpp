@@ -0,0 +1,217 @@
+#include "./catch_1.10.0.hpp"
+#include <system/core.hpp>
+#include <test_motordriver.hpp>
+
+namespace supreme {
+namespace local_tests {
+
+using core_t = sensorimotor_core<test_motordriver>;
+
+/* runs the core until the watchcat trips, returns the number of steps */
+unsigned run_until_watchcat(core_t& core) {
+	unsigned n = 0;
+	while (core.is_enabled() and n < 0xffff) {
+		core.step();
+		++n;
+	}
+	return n;
+}
+
+TEST_CASE( "watchcat trips after the configured timeout", "[core]")
+{
+	adc::result[adc::position] = 0;
+	core_t core;
+
+	REQUIRE( core.get_watchcat_timeout() == defaults::watchcat_10ms );
+
+	core.set_target_pwm(10);
+	core.enable();
+	REQUIRE( run_until_watchcat(core) == control_rate::ms_to_cycles(100) + 1u );
+	REQUIRE( core.get_faults() == fault::watchcat );
+	REQUIRE( core.get_watchcat_trips() == 1 );
+
+	/* 30ms */
+	core.set_watchcat_timeout(3);
+	REQUIRE( core.get_watchcat_timeout() == 3 );
+	core.enable();
+	REQUIRE( run_until_watchcat(core) == control_rate::ms_to_cycles(30) + 1u );
+	REQUIRE( core.get_watchcat_trips() == 2 );
+
+	/* motor requests restart the timeout */
+	core.enable();
+	for (unsigned i = 0; i < 10; ++i) {
+		for (unsigned k = 0; k < control_rate::ms_to_cycles(20); ++k)
+			core.step();
+		core.enable();
+	}
+	REQUIRE( core.is_enabled() );
+	REQUIRE( core.get_watchcat_trips() == 2 );
+
+	/* 0 selects the default */
+	core.set_watchcat_timeout(0);
+	REQUIRE( core.get_watchcat_timeout() == defaults::watchcat_10ms );
+}
+
+TEST_CASE( "coast disables the motor bridge once the watchcat trips", "[core]")
+{
+	adc::result[adc::position] = 0;
+	core_t core;
+	core.set_stop_mode(stop::coast);
+
+	core.set_target_pwm(20);
+	core.enable();
+	core.step();
+	REQUIRE( bridge.enabled );
+	REQUIRE( bridge.pwm == 20 );
+
+	run_until_watchcat(core);
+	REQUIRE( not core.is_stopping() );
+	core.step();
+	REQUIRE( not bridge.enabled );
+	REQUIRE( bridge.pwm == 0 );
+	REQUIRE( core.get_target_pwm() == 0 );
+
+	/* invalid modes select coast */
+	core.set_stop_mode(stop::num_modes);
+	REQUIRE( core.get_stop_mode() == stop::coast );
+}
+
+TEST_CASE( "ramp reduces the pwm by one step per ramp period, then coasts", "[core]")
+{
+	adc::result[adc::position] = 0;
+	core_t core;
+	core.set_stop_mode(stop::ramp);
+
+	core.set_target_pwm(20);
+	core.set_target_dir(false);
+	core.enable();
+	run_until_watchcat(core);
+	REQUIRE( core.is_stopping() );
+	REQUIRE( core.get_faults() == fault::watchcat );
+	REQUIRE( bridge.pwm == 20 );
+
+	for (int pwm = 19; pwm >= 0; --pwm) {
+		for (unsigned k = 1; k < defaults::ramp_cycles; ++k) {
+			core.step();
+			REQUIRE( bridge.pwm == pwm + 1 );
+		}
+		core.step();
+		REQUIRE( bridge.pwm == pwm );
+		REQUIRE( bridge.enabled );
+		REQUIRE( bridge.dir == false );
+	}
+	REQUIRE( core.is_stopping() );
+
+	/* one more ramp period at zero, then the bridge is disabled */
+	for (unsigned k = 0; k < defaults::ramp_cycles; ++k)
+		core.step();
+	REQUIRE( not core.is_stopping() );
+	REQUIRE( not bridge.enabled );
+	REQUIRE( bridge.pwm == 0 );
+}
+
+TEST_CASE( "hold keeps the position by proportional control with the hold gain", "[core]")
+{
+	adc::result[adc::position] = 500;
+	core_t core;
+	core.set_stop_mode(stop::hold);
+	core.set_hold_gain(16); /* 2 pwm steps per adc step */
+
+	core.set_target_pwm(20);
+	core.enable();
+	run_until_watchcat(core);
+	REQUIRE( core.is_stopping() );
+
+	/* on target */
+	core.step();
+	REQUIRE( bridge.enabled );
+	REQUIRE( bridge.pwm == 0 );
+
+	/* position dropped by 5, driven towards increasing position */
+	adc::result[adc::position] = 495;
+	core.step(); /* sampled */
+	core.step();
+	REQUIRE( bridge.enabled );
+	REQUIRE( bridge.dir == true );
+	REQUIRE( bridge.pwm == 10 );
+
+	/* overshoot by 40, driven back, limited by the pwm limit */
+	adc::result[adc::position] = 540;
+	core.step();
+	core.step();
+	REQUIRE( bridge.dir == false );
+	REQUIRE( bridge.pwm == defaults::pwm_limit );
+
+	/* negative gain for reversed wiring */
+	core.set_hold_gain(-16);
+	core.step();
+	REQUIRE( bridge.dir == true );
+	REQUIRE( bridge.pwm == defaults::pwm_limit );
+
+	/* held until the next motor request */
+	for (unsigned k = 0; k < control_rate::ms_to_cycles(1000); ++k)
+		core.step();
+	REQUIRE( core.is_stopping() );
+	core.set_target_pwm(0);
+	core.enable();
+	REQUIRE( not core.is_stopping() );
+
+	adc::result[adc::position] = 0;
+}
+
+TEST_CASE( "brake drives zero pwm with the bridge enabled", "[core]")
+{
+	adc::result[adc::position] = 0;
+	core_t core;
+	core.set_stop_mode(stop::brake);
+
+	core.set_target_pwm(20);
+	core.enable();
+	run_until_watchcat(core);
+	REQUIRE( core.is_stopping() );
+
+	for (unsigned k = 0; k < control_rate::ms_to_cycles(1000); ++k) {
+		core.step();
+		REQUIRE( bridge.enabled );
+		REQUIRE( bridge.pwm == 0 );
+	}
+	REQUIRE( core.is_stopping() );
+
+	/* state requests end the safe stop, the bridge is disabled */
+	core.disable();
+	core.step();
+	REQUIRE( not core.is_stopping() );
+	REQUIRE( not bridge.enabled );
+
+	/* a hold gain of 0 brakes as well */
+	core.set_stop_mode(stop::hold);
+	core.set_hold_gain(0);
+	core.set_target_pwm(20);
+	core.enable();
+	run_until_watchcat(core);
+	adc::result[adc::position] = 100;
+	core.step();
+	core.step();
+	REQUIRE( bridge.enabled );
+	REQUIRE( bridge.pwm == 0 );
+
+	adc::result[adc::position] = 0;
+}
+
+/* octaves above 1kHz of a rate given in 1/256 of 1kHz, as for control_rate */
+constexpr uint8_t octaves(uint32_t hz) { return control_rate::log2(hz * 256 / 1000 * 181 / 128 / 256); }
+
+TEST_CASE( "position lowpass shift is scaled by the control rate", "[core]")
+{
+	REQUIRE( control_rate::octaves == 0 );
+	REQUIRE( defaults::lowpass_shift == 1 );
+
+	/* nearest power of two of the rate ratio */
+	REQUIRE( octaves(1250) == 0 );
+	REQUIRE( octaves(2000) == 1 );
+	REQUIRE( octaves(2500) == 1 );
+	REQUIRE( octaves(3125) == 2 );
+	REQUIRE( octaves(5000) == 2 );
+}
+
+}} /* namespace supreme::local_tests */
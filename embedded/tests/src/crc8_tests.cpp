@@ -0,0 +1,48 @@
+#include "./catch_1.10.0.hpp"
+#include <common/crc8.hpp>
+
+namespace supreme {
+namespace local_tests {
+
+uint8_t crc8_bitwise(uint8_t crc, uint8_t byte) {
+	crc ^= byte;
+	for (unsigned i = 0; i < 8; ++i)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+	return crc;
+}
+
+template <typename T>
+uint8_t crc8(T const& data) {
+	uint8_t crc = 0;
+	for (auto const& d : data)
+		crc = crc8_update(crc, d);
+	return crc;
+}
+
+TEST_CASE( "crc8 lookup table matches bitwise computation", "[crc8]")
+{
+	for (unsigned crc = 0; crc < 256; ++crc)
+		for (unsigned byte = 0; byte < 256; byte += 17)
+			REQUIRE( crc8_update(crc, byte) == crc8_bitwise(crc, byte) );
+}
+
+TEST_CASE( "crc8 check value and zero residue", "[crc8]")
+{
+	std::vector<uint8_t> check = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	REQUIRE( crc8(check) == 0xF4 );
+
+	check.push_back(0xF4);
+	REQUIRE( crc8(check) == 0 );
+}
+
+TEST_CASE( "crc8 detects errors missed by additive checksum", "[crc8]")
+{
+	std::vector<uint8_t> data    = { 0xB1, 23, 64 };
+	std::vector<uint8_t> swapped = { 0xB1, 64, 23 };
+	std::vector<uint8_t> cancel  = { 0xB1, 24, 63 };
+
+	REQUIRE( crc8(data) != crc8(swapped) );
+	REQUIRE( crc8(data) != crc8(cancel) );
+}
+
+}} /* namespace supreme::local_tests */
@@ -0,0 +1,277 @@
+#include <system/communication.hpp>
+#include <xpcc/architecture/platform.hpp>
+#include "./catch_1.10.0.hpp"
+
+#include <test_sensorimotor_core.hpp>
+#include <test_communication.hpp>
+#include <test_motordriver.hpp>
+#include <system/core.hpp>
+#include <system/trace.hpp>
+#include <vector>
+
+namespace supreme {
+namespace local_tests {
+
+TEST_CASE( "prbs excitation is reproducible from its seed", "[excitation]")
+{
+	excitation::generator gen;
+	gen.set_signal(excitation::prbs);
+	gen.set_amplitude(40);
+	gen.set_bias(5);
+	gen.set_hold(3);
+	gen.set_seed(0x1234);
+	gen.set_length(300);
+
+	std::vector<int16_t> first;
+	int16_t u = 0;
+	gen.start();
+	while (gen.next(u)) first.push_back(u);
+	REQUIRE( first.size() == 300 );
+	REQUIRE( not gen.is_running() );
+
+	/* reference lfsr, each bit held for 3 cycles */
+	uint16_t lfsr = 0x1234;
+	for (unsigned i = 0; i < first.size(); ++i) {
+		REQUIRE( first[i] == ((lfsr & 0x1) ? 45 : -35) );
+		if (i % 3 == 2) lfsr = (lfsr >> 1) ^ ((lfsr & 0x1) ? 0xB400 : 0);
+	}
+
+	/* same seed, same sequence */
+	gen.start();
+	for (unsigned i = 0; i < first.size(); ++i) {
+		REQUIRE( gen.next(u) );
+		REQUIRE( u == first[i] );
+	}
+
+	/* zero seed would lock the lfsr */
+	gen.set_seed(0);
+	gen.set_hold(1);
+	gen.start();
+	unsigned changes = 0;
+	int16_t last = 0;
+	for (unsigned i = 0; gen.next(u); ++i) {
+		if (i > 0 and u != last) ++changes;
+		last = u;
+	}
+	REQUIRE( changes > 100 );
+}
+
+TEST_CASE( "chirp excitation sweeps the frequency", "[excitation]")
+{
+	REQUIRE( excitation::increment(2500) == 0x40000000 ); /* 250Hz at 1kHz, a quarter period per cycle */
+
+	excitation::generator gen;
+	gen.set_signal(excitation::chirp);
+	gen.set_amplitude(100);
+	gen.set_f0(2500);
+	gen.set_f1(2500);
+	gen.set_length(8);
+
+	int16_t u = 0;
+	const int16_t expected[8] = { 0, 99, 0, -99, 0, 99, 0, -99 };
+	gen.start();
+	for (unsigned i = 0; i < 8; ++i) {
+		REQUIRE( gen.next(u) );
+		REQUIRE( u == expected[i] );
+	}
+	REQUIRE( not gen.next(u) );
+
+	/* 1Hz to 200Hz, more zero crossings in the 2nd half */
+	gen.set_f0(10);
+	gen.set_f1(2000);
+	gen.set_length(1000);
+	gen.set_bias(-10);
+	gen.start();
+	unsigned crossings[2] = { 0, 0 };
+	int16_t last = -10;
+	for (unsigned i = 0; gen.next(u); ++i) {
+		REQUIRE( u <= 100 - 10 );
+		REQUIRE( u >= -100 - 10 );
+		if ((last < -10) != (u < -10)) ++crossings[i / 500];
+		last = u;
+	}
+	REQUIRE( crossings[0] > 20 );
+	REQUIRE( crossings[1] > 2 * crossings[0] );
+}
+
+TEST_CASE( "core runs the identification synchronously with the trace", "[excitation]")
+{
+	sensorimotor_core<test_motordriver> core;
+	core.set_pwm_limit(30);
+	excitation::generator& gen = core.get_excitation();
+	gen.set_signal(excitation::prbs);
+	gen.set_amplitude(50);
+	gen.set_seed(0xBEEF);
+	gen.set_length(500); /* longer than the watchcat timeout */
+
+	trace::trace_recorder rec;
+	rec.set_channels(trace::pwm);
+	rec.command(trace::arm);
+	rec.command(trace::trigger);
+
+	core.start_identification();
+	REQUIRE( core.is_identifying() );
+	for (unsigned i = 0; i < 500; ++i) {
+		core.step();
+		rec.record(core);
+		REQUIRE( core.is_enabled() );
+	}
+	REQUIRE( (core.get_faults() & fault::watchcat) == 0 );
+
+	/* end of run disables the motor */
+	core.step();
+	REQUIRE( not core.is_identifying() );
+	REQUIRE( not core.is_enabled() );
+
+	/* recorded from the 1st cycle, limited by the pwm limit */
+	REQUIRE( rec.get_trigger_pos() == 0 );
+	REQUIRE( rec.get_samples() == trace::buffer_words );
+	excitation::generator ref = gen;
+	int16_t u = 0;
+	ref.start();
+	for (unsigned k = 0; k < trace::buffer_words; ++k) {
+		REQUIRE( ref.next(u) );
+		const int16_t pwm = (rec.get_byte(2*k) << 8) | rec.get_byte(2*k+1);
+		REQUIRE( pwm == ((u < 0) ? -30 : 30) );
+	}
+
+	/* a motor request takes over */
+	core.start_identification();
+	core.step();
+	core.set_target_pwm(10);
+	core.enable();
+	REQUIRE( not core.is_identifying() );
+	core.step();
+	REQUIRE( core.get_target_pwm() == 10 );
+}
+
+TEST_CASE( "identification is configured and started by registers", "[excitation]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	core_t ux;
+	exts_t ex;
+	supreme::communication_ctrl<core_t, exts_t> com(ux, ex);
+
+	REQUIRE( (capabilities::features & capabilities::identification) != 0 );
+
+	/* signal, amplitude, bias, length, seed, hold, gap, f0, f1 */
+	send({ 0x60, 23, /*addr=*/0xE1, /*len=*/13, 1, 80, 0xFB, 0x00, 0x64, 0x12, 0x34, 2, 0, 0x00, 0x0A, 0x07, 0xD0 });
+	com.step();
+	auto const& gen = ux.get_excitation();
+	REQUIRE( gen.get_signal()    == excitation::chirp );
+	REQUIRE( gen.get_amplitude() == 80 );
+	REQUIRE( gen.get_bias()      == -5 );
+	REQUIRE( gen.get_length()    == 100 );
+	REQUIRE( gen.get_seed()      == 0x1234 );
+	REQUIRE( gen.get_hold()      == 2 );
+	REQUIRE( gen.get_f0()        == 10 );
+	REQUIRE( gen.get_f1()        == 2000 );
+
+	Uart0::recv_buffer.clear();
+	send({ 0x50, 23, /*addr=*/0xE0, /*len=*/14 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 14 + 1 );
+	REQUIRE( Uart0::recv_buffer[5] == 0 );    /* not running */
+	REQUIRE( Uart0::recv_buffer[8] == 0xFB ); /* bias */
+	REQUIRE( get_signed_word(Uart0::recv_buffer[17], Uart0::recv_buffer[18]) == 2000 );
+
+	/* a single write starts the run and the trace */
+	trace::recorder.set_channels(trace::position | trace::pwm);
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 1 });
+	com.step();
+	REQUIRE( ux.is_identifying() );
+	REQUIRE( trace::recorder.get_state() == trace::armed );
+	trace::recorder.record(ux);
+	REQUIRE( trace::recorder.get_state() == trace::triggered );
+	REQUIRE( trace::recorder.get_trigger_pos() == 0 );
+	REQUIRE( ((com.get_status_word() >> 8) & status::identifying) != 0 );
+
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 0 });
+	com.step();
+	REQUIRE( not ux.is_identifying() );
+	REQUIRE( not ux.is_enabled() );
+	REQUIRE( ((com.get_status_word() >> 8) & status::identifying) == 0 );
+
+	trace::recorder.set_channels(trace::default_channels);
+}
+
+TEST_CASE( "run length is limited to the hard timeout", "[excitation]")
+{
+	REQUIRE( excitation::max_length == control_rate::ms_to_cycles(5000) );
+
+	excitation::generator gen;
+	REQUIRE( gen.get_length() == excitation::default_length );
+	gen.set_length(60000);
+	REQUIRE( gen.get_length() == excitation::max_length );
+	gen.set_length(excitation::max_length - 1);
+	REQUIRE( gen.get_length() == excitation::max_length - 1 );
+
+	gen.set_length(0xffff);
+	gen.set_hold(1);
+	unsigned n = 0;
+	int16_t u = 0;
+	gen.start();
+	while (gen.next(u)) ++n;
+	REQUIRE( n == excitation::max_length );
+}
+
+TEST_CASE( "run not fitting into the trace is not started", "[excitation]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	core_t ux;
+	exts_t ex;
+	supreme::communication_ctrl<core_t, exts_t> com(ux, ex);
+
+	/* default run fits the default channels, the divider is kept */
+	REQUIRE( trace::recorder.get_capacity() == excitation::default_length );
+	send({ 0x60, 23, /*addr=*/0xC2, /*len=*/1, 3 });
+	com.step();
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 1 });
+	com.step();
+	REQUIRE( ux.is_identifying() );
+	REQUIRE( trace::recorder.get_state() == trace::armed );
+	REQUIRE( trace::recorder.get_divider() == 3 );
+	REQUIRE( trace::recorder.get_channels() == trace::default_channels );
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 0 });
+	com.step();
+	trace::recorder.command(trace::stop);
+
+	/* one cycle more than the capacity */
+	send({ 0x60, 23, /*addr=*/0xE4, /*len=*/2, 0x00, excitation::default_length + 1 });
+	com.step();
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 1 });
+	com.step();
+	REQUIRE( not ux.is_identifying() );
+	REQUIRE( not ux.is_enabled() );
+	REQUIRE( trace::recorder.get_state() == trace::stopped );
+	REQUIRE( trace::recorder.get_divider() == 3 );
+
+	Uart0::recv_buffer.clear();
+	send({ 0x50, 23, /*addr=*/0xE0, /*len=*/1 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 1 + 1 );
+	REQUIRE( Uart0::recv_buffer[5] == 0 ); /* not running */
+
+	/* fits with fewer channels */
+	trace::recorder.set_channels(trace::position | trace::pwm);
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 1 });
+	com.step();
+	REQUIRE( ux.is_identifying() );
+	REQUIRE( trace::recorder.get_state() == trace::armed );
+
+	send({ 0x60, 23, /*addr=*/0xE0, /*len=*/1, 0 });
+	com.step();
+	trace::recorder.command(trace::stop);
+	trace::recorder.set_channels(trace::default_channels);
+	trace::recorder.set_divider(1);
+}
+
+}} /* namespace supreme::local_tests */
@@ -0,0 +1,61 @@
+#include <system/communication.hpp>
+#include <xpcc/architecture/platform.hpp>
+#include "./catch_1.10.0.hpp"
+
+#include <test_sensorimotor_core.hpp>
+#include <test_communication.hpp>
+#include <test_motordriver.hpp>
+#include <system/core.hpp>
+#include <system/ram_budget.hpp>
+
+namespace supreme {
+namespace local_tests {
+
+TEST_CASE( "subsystems stay within their RAM budgets", "[memory]")
+{
+	using core_t = sensorimotor_core<test_motordriver>;
+	using com_t  = supreme::communication_ctrl<test_sensorimotor_core, ExternalSensor>;
+
+	/* sizes on the host are an upper bound of those on the target */
+	REQUIRE( sizeof(core_t) <= ram_budget::core );
+	REQUIRE( sizeof(com_t)  <= ram_budget::communication );
+	REQUIRE( sizeof(trace::recorder) <= ram_budget::trace );
+	/* the external sensor is a mock on the host, checked in main.cpp only */
+
+	/* static data, like the uart buffers, needs the remaining RAM */
+	REQUIRE( ram_budget::core + ram_budget::communication + ram_budget::ext_sensor
+	       + ram_budget::trace + ram_budget::stack_reserve <= ram_budget::ram_size * 3 / 4 );
+}
+
+TEST_CASE( "memory usage is read as registers", "[memory]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	memory::mock_static_size = 1200;
+	memory::mock_unused = 300;
+	memory::mock_stack_peak = 548;
+
+	send({ 0x50, 23, /*addr=*/0xA4, /*len=*/12 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 12 + 1 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 5], Uart0::recv_buffer[ 6]) == 1200 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 7], Uart0::recv_buffer[ 8]) ==  300 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 9], Uart0::recv_buffer[10]) ==  548 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[11], Uart0::recv_buffer[12]) == (int) sizeof(core_t) );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[13], Uart0::recv_buffer[14]) == (int) sizeof(com_t) );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[15], Uart0::recv_buffer[16]) == (int) sizeof(exts_t) );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+}
+
+}} /* namespace supreme::local_tests */
@@ -0,0 +1,108 @@
+#define SUPREME_PROFILING 1
+
+#include <system/profiler.hpp>
+#include <system/communication.hpp>
+#include <xpcc/architecture/platform.hpp>
+#include "./catch_1.10.0.hpp"
+
+#include <test_sensorimotor_core.hpp>
+#include <test_communication.hpp>
+#include <system/timer.hpp>
+
+namespace supreme {
+
+/* this is the only test file built with profiling */
+volatile profile::section_stats profile::stats[profile::num_sections];
+
+namespace local_tests {
+
+/* the other test files instantiate the communication without profiling,
+   a core type of its own keeps this instantiation apart */
+struct profiled_core : public test_sensorimotor_core {};
+
+TEST_CASE( "profiler sections accumulate time, calls and maximum", "[profiler]")
+{
+	timer::init();
+	profile::reset();
+
+	{
+		profile::scope p(profile::communication);
+		timer::advance_us(20);
+	}
+	{
+		profile::scope p(profile::communication);
+		timer::advance_us(60);
+	}
+
+	REQUIRE( profile::get_word(profile::communication, 0) == 0 );
+	REQUIRE( profile::get_word(profile::communication, 1) == 40 ); // ticks of 2us
+	REQUIRE( profile::get_word(profile::communication, 2) == 2 );
+	REQUIRE( profile::get_word(profile::communication, 3) == 30 );
+	REQUIRE( profile::get_word(profile::communication, 4) == 0 );  // no such word
+	REQUIRE( profile::get_word(profile::ext_sensor, 2) == 0 );
+
+	/* total time exceeds 16 bit */
+	for (unsigned i = 0; i < 3; ++i) {
+		profile::scope p(profile::ext_sensor);
+		timer::advance_us(60000);
+	}
+	REQUIRE( profile::get_word(profile::ext_sensor, 0) == 1 );
+	REQUIRE( profile::get_word(profile::ext_sensor, 1) == 3 * 30000 - 0x10000 );
+	REQUIRE( profile::get_word(profile::ext_sensor, 3) == 30000 );
+
+	profile::reset();
+	for (unsigned w = 0; w < 4; ++w)
+		REQUIRE( profile::get_word(profile::communication, w) == 0 );
+}
+
+TEST_CASE( "profiler sections accumulate time and calls and are read as registers", "[profiler]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+	profile::reset();
+
+	using core_t = profiled_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+
+	for (unsigned i = 0; i < 3; ++i) {
+		profile::scope p(profile::control);
+		timer::advance_us(100 + 100*i);
+	}
+	{
+		profile::scope p(profile::adc_isr);
+		timer::advance_us(4);
+	}
+
+	REQUIRE( (capabilities::features & capabilities::profiling) != 0 );
+
+	/* control and adc isr sections */
+	send({ 0x50, 23, /*addr=*/0x88, /*len=*/16 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 16 + 1 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 5], Uart0::recv_buffer[ 6]) ==   0 ); // ticks hi
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 7], Uart0::recv_buffer[ 8]) == 300 ); // ticks lo
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 9], Uart0::recv_buffer[10]) ==   3 ); // calls
+	REQUIRE( get_signed_word(Uart0::recv_buffer[11], Uart0::recv_buffer[12]) == 150 ); // max
+	REQUIRE( get_signed_word(Uart0::recv_buffer[13], Uart0::recv_buffer[14]) ==   0 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[15], Uart0::recv_buffer[16]) ==   2 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[17], Uart0::recv_buffer[18]) ==   1 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[19], Uart0::recv_buffer[20]) ==   2 );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* reset along with diagnostics */
+	reset_hardware();
+	send({ 0x20, 23, /*reset=*/1 });
+	com.step();
+	REQUIRE( profile::get_word(profile::control, 1) == 0 );
+	REQUIRE( profile::get_word(profile::control, 2) == 0 );
+}
+
+}} /* namespace supreme::local_tests */
@@ -0,0 +1,184 @@
+#include <system/communication.hpp>
+#include <xpcc/architecture/platform.hpp>
+#include "./catch_1.10.0.hpp"
+
+#include <test_sensorimotor_core.hpp>
+#include <test_communication.hpp>
+#include <system/timer.hpp>
+#include <system/scheduler.hpp>
+
+namespace supreme {
+namespace local_tests {
+
+const uint8_t health_ticks = schedule::divider[schedule::health];
+
+/* runs all due groups of one pass, returns them as bit mask */
+uint8_t run_pass(scheduler& sched, uint8_t tick) {
+	uint8_t ran = 0;
+	sched.update(tick);
+	for (uint8_t g = 0; g < schedule::num_groups; ++g) {
+		const schedule::group_t group = static_cast<schedule::group_t>(g);
+		if (sched.begin(group)) {
+			sched.end(group);
+			ran |= 1 << g;
+		}
+	}
+	return ran;
+}
+
+TEST_CASE( "rate groups are run by their dividers, background on every pass", "[scheduler]")
+{
+	timer::init();
+	timing::loop.reset();
+	scheduler sched;
+
+	const uint8_t control    = 1 << schedule::control;
+	const uint8_t health     = 1 << schedule::health;
+	const uint8_t background = 1 << schedule::background;
+
+	/* no tick yet */
+	REQUIRE( run_pass(sched, 0) == background );
+	REQUIRE( run_pass(sched, 0) == background );
+
+	unsigned health_runs = 0;
+	for (unsigned t = 1; t <= 3u * health_ticks; ++t) {
+		const uint8_t ran = run_pass(sched, t);
+		REQUIRE( (ran & control) );
+		REQUIRE( (ran & background) );
+		if (ran & health) {
+			++health_runs;
+			REQUIRE( t % health_ticks == 0 );
+		}
+		/* a group is run only once per due tick */
+		REQUIRE( run_pass(sched, t) == background );
+	}
+	REQUIRE( health_runs == 3 );
+	REQUIRE( timing::loop.get_missed_ticks() == 0 );
+}
+
+TEST_CASE( "ticks passed unnoticed count down the rate groups and are counted as missed", "[scheduler]")
+{
+	timer::init();
+	timing::loop.reset();
+	scheduler sched;
+
+	const uint8_t health = 1 << schedule::health;
+
+	/* 3 ticks at once, health is 3 ticks closer to be due */
+	REQUIRE( not (run_pass(sched, 3) & health) );
+	REQUIRE( timing::loop.get_missed_ticks() == 2 );
+
+	uint8_t t = 3;
+	while (not (run_pass(sched, ++t) & health)) {}
+	REQUIRE( t == health_ticks );
+
+	/* a long stall runs health once, the period restarts afterwards */
+	t += 2 * health_ticks + 5;
+	REQUIRE( (run_pass(sched, t) & health) );
+	REQUIRE( timing::loop.get_missed_ticks() == 2 + 2 * health_ticks + 4 );
+
+	const uint8_t due = t + health_ticks;
+	while (not (run_pass(sched, ++t) & health)) {}
+	REQUIRE( t == due );
+
+	/* tick counter wraps around */
+	sched = scheduler();
+	REQUIRE( (run_pass(sched, 0xfe) & health) );
+	t = 0xfe;
+	while (not (run_pass(sched, ++t) & health)) {}
+	REQUIRE( t == (uint8_t) (0xfe + health_ticks) );
+}
+
+TEST_CASE( "rate groups exceeding their budget are counted as overrun", "[scheduler]")
+{
+	timer::init();
+	timing::loop.reset();
+	scheduler sched;
+
+	sched.update(1);
+	REQUIRE( sched.begin(schedule::control) );
+	timer::advance_us(schedule::budget_us[schedule::control] - 2);
+	sched.end(schedule::control);
+	REQUIRE( sched.begin(schedule::background) );
+	timer::advance_us(schedule::budget_us[schedule::background]);
+	sched.end(schedule::background);
+
+	REQUIRE( timing::loop.get_overruns(schedule::control)    == 0 );
+	REQUIRE( timing::loop.get_overruns(schedule::health)     == 0 );
+	REQUIRE( timing::loop.get_overruns(schedule::background) == 1 );
+}
+
+TEST_CASE( "control loop timing is measured by the scheduler and read as registers", "[scheduler]")
+{
+	reset_hardware();
+	set_motor_id(23);
+	timer::init();
+	timing::loop.reset();
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	using com_t = supreme::communication_ctrl<core_t, exts_t>;
+
+	core_t ux;
+	exts_t ex;
+	com_t com(ux, ex);
+	scheduler sched;
+
+	/* first tick: 10us latency, 100us execution */
+	timing::loop.tick();
+	timer::advance_us(10);
+	sched.update(1);
+	REQUIRE( sched.begin(schedule::control) );
+	REQUIRE( not sched.begin(schedule::control) );
+	REQUIRE( not sched.begin(schedule::health) );
+	timer::advance_us(100);
+	sched.end(schedule::control);
+
+	/* second tick: 30us latency, 500us execution, over budget */
+	timing::loop.tick();
+	timer::advance_us(30);
+	sched.update(2);
+	REQUIRE( sched.begin(schedule::control) );
+	timer::advance_us(500);
+	sched.end(schedule::control);
+	REQUIRE( sched.begin(schedule::background) );
+	sched.end(schedule::background);
+
+	/* two ticks passed unnoticed */
+	sched.update(5);
+
+	send({ 0x50, 23, /*addr=*/0x60, /*len=*/16 });
+	com.step();
+
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 16 + 1 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x51 );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 5], Uart0::recv_buffer[ 6]) == 100 ); // min
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 7], Uart0::recv_buffer[ 8]) == 500 ); // max
+	REQUIRE( get_signed_word(Uart0::recv_buffer[ 9], Uart0::recv_buffer[10]) == 124 ); // mean
+	REQUIRE( get_signed_word(Uart0::recv_buffer[11], Uart0::recv_buffer[12]) ==  20 ); // jitter
+	REQUIRE( get_signed_word(Uart0::recv_buffer[13], Uart0::recv_buffer[14]) ==   2 ); // missed
+	REQUIRE( get_signed_word(Uart0::recv_buffer[15], Uart0::recv_buffer[16]) ==   1 ); // control
+	REQUIRE( get_signed_word(Uart0::recv_buffer[17], Uart0::recv_buffer[18]) ==   0 ); // health
+	REQUIRE( get_signed_word(Uart0::recv_buffer[19], Uart0::recv_buffer[20]) ==   0 ); // background
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* log2 histogram of execution times */
+	reset_hardware();
+	send({ 0x50, 23, /*addr=*/0x70, /*len=*/16 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 16 + 1 );
+	for (unsigned b = 0; b < 8; ++b)
+		REQUIRE( get_signed_word(Uart0::recv_buffer[5 + 2*b], Uart0::recv_buffer[6 + 2*b]) == ((b == 3 or b == 5) ? 1 : 0) );
+
+	/* reset along with diagnostics */
+	reset_hardware();
+	send({ 0x20, 23, /*reset=*/1 });
+	com.step();
+	REQUIRE( timing::loop.get_exec_max() == 0 );
+	REQUIRE( timing::loop.get_exec_min() == 0 );
+	REQUIRE( timing::loop.get_missed_ticks() == 0 );
+	REQUIRE( timing::loop.get_histogram(3) == 0 );
+}
+
+}} /* namespace supreme::local_tests */
@@ -0,0 +1,20 @@
+#ifndef TEST_SUPREME_ADC_HPP
+#define TEST_SUPREME_ADC_HPP
+
+/* replaces the adc scan, results are set by the tests */
+
+namespace supreme {
+namespace adc {
+
+	const uint8_t position         = 0;
+	const uint8_t current          = 1;
+	const uint8_t voltage_back_emf = 2;
+	const uint8_t voltage_supply   = 3;
+	const uint8_t temperature      = 4;
+
+	extern uint16_t result[8];
+
+} /* namespace adc */
+} /* namespace supreme */
+
+#endif /* TEST_SUPREME_ADC_HPP */
@@ -0,0 +1,23 @@
+#ifndef TEST_SUPREME_BAUDRATE_HPP
+#define TEST_SUPREME_BAUDRATE_HPP
+
+/* replaces the hardware baud rate selection, records the current rate */
+
+namespace supreme {
+namespace uart {
+
+	enum baudrate_t {
+		baud_1M = 0,
+		baud_2M = 1,
+		num_baudrates
+	};
+
+	extern uint8_t  mock_baudrate;
+	extern unsigned mock_baudrate_changes;
+
+	inline void set_baudrate(uint8_t code) { mock_baudrate = code; ++mock_baudrate_changes; }
+
+} /* namespace uart */
+} /* namespace supreme */
+
+#endif /* TEST_SUPREME_BAUDRATE_HPP */
@@ -0,0 +1,20 @@
+#ifndef TEST_SUPREME_MEMORY_HPP
+#define TEST_SUPREME_MEMORY_HPP
+
+/* replaces the stack painting, usage is set by the tests */
+
+namespace supreme {
+namespace memory {
+
+	extern uint16_t mock_static_size;
+	extern uint16_t mock_unused;
+	extern uint16_t mock_stack_peak;
+
+	inline uint16_t static_size(void) { return mock_static_size; }
+	inline uint16_t unused     (void) { return mock_unused; }
+	inline uint16_t stack_peak (void) { return mock_stack_peak; }
+
+} /* namespace memory */
+} /* namespace supreme */
+
+#endif /* TEST_SUPREME_MEMORY_HPP */
@@ -0,0 +1,28 @@
+#ifndef TEST_SUPREME_TIMER_HPP
+#define TEST_SUPREME_TIMER_HPP
+
+/* replaces the hardware time base, time is advanced by the tests */
+
+namespace supreme {
+namespace timer {
+
+	const uint8_t us_per_tick = 2;
+
+	constexpr uint16_t us_to_ticks(uint16_t us) { return us / us_per_tick; }
+
+	extern uint16_t mock_time;
+
+	inline void init() { mock_time = 0; }
+
+	inline uint16_t now(void) { return mock_time; }
+
+	inline bool elapsed(uint16_t since, uint16_t ticks) { return (uint16_t)(now() - since) >= ticks; }
+
+	inline bool reached(uint16_t deadline) { return (int16_t)(now() - deadline) >= 0; }
+
+	inline void advance_us(uint16_t us) { mock_time += us_to_ticks(us); }
+
+} /* namespace timer */
+} /* namespace supreme */
+
+#endif /* TEST_SUPREME_TIMER_HPP */
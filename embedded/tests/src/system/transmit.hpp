@@ -0,0 +1,18 @@
+#ifndef TEST_SUPREME_TRANSMIT_HPP
+#define TEST_SUPREME_TRANSMIT_HPP
+
+/* replaces the direct transmission, records the bytes sent */
+
+namespace supreme {
+namespace uart {
+
+	inline void transmit(const uint8_t* data, uint16_t len) {
+		for (uint16_t i = 0; i < len; ++i)
+			Uart0::recv_buffer.push_back(data[i]);
+		Uart0::buffer_flushed = true;
+	}
+
+} /* namespace uart */
+} /* namespace supreme */
+
+#endif /* TEST_SUPREME_TRANSMIT_HPP */
@@ -0,0 +1,54 @@
+#ifndef TEST_SUPREME_COMMUNICATION_HPP
+#define TEST_SUPREME_COMMUNICATION_HPP
+
+#include <xpcc/architecture/platform.hpp>
+#include <common/crc8.hpp>
+
+/* frames sent by the host and checks of the responses */
+
+namespace supreme {
+namespace local_tests {
+
+template <typename T>
+bool verify_checksum(T const& data) {
+	uint8_t sum = 0;
+	for (auto const& d : data)
+		sum += d;
+	return sum == 0;
+}
+
+inline void send(std::vector<uint8_t> buf) {
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xff);
+	uint8_t chksum = 0xfe;
+	for (auto& b : buf) {
+		chksum += b;
+		Uart0::send_queue.push(b);
+	}
+	Uart0::send_queue.push(~chksum + 1);
+}
+
+inline void send_crc8(std::vector<uint8_t> buf) {
+	Uart0::send_queue.push(0xff);
+	Uart0::send_queue.push(0xfd);
+	uint8_t crc = 0x2a; /* crc8 of sync bytes */
+	for (auto& b : buf) {
+		crc = crc8_update(crc, b);
+		Uart0::send_queue.push(b);
+	}
+	Uart0::send_queue.push(crc);
+}
+
+template <typename T>
+bool verify_crc8(T const& data) {
+	uint8_t crc = 0;
+	for (auto const& d : data)
+		crc = crc8_update(crc, d);
+	return crc == 0;
+}
+
+inline int16_t get_signed_word(uint8_t hi, uint8_t lo) { return (hi << 8) | lo; }
+
+}} /* namespace supreme::local_tests */
+
+#endif /* TEST_SUPREME_COMMUNICATION_HPP */
@@ -0,0 +1,60 @@
+/* single definitions of the mocked hardware and of the firmware's
+   global instances, which are otherwise defined in main.cpp */
+
+#include <xpcc/architecture/platform.hpp>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <system/adc.hpp>
+#include <system/baudrate.hpp>
+#include <system/memory.hpp>
+#include <system/timer.hpp>
+#include <system/loop_timing.hpp>
+#include <system/clock_sync.hpp>
+#include <system/trace.hpp>
+#include <test_motordriver.hpp>
+
+uint8_t SREG = 0;
+uint8_t TCNT0 = 0;
+uint8_t OCR0A = 249;
+
+eeprom_mock eeprom;
+
+namespace Uart0 {
+	std::vector<uint8_t> recv_buffer;
+	bool buffer_flushed = false;
+	std::queue<uint8_t> send_queue;
+	uint8_t error_flags = 0;
+}
+
+namespace rs485 {
+	stats_t stats;
+}
+
+namespace supreme {
+
+	namespace adc {
+		uint16_t result[8] = { 0 };
+	}
+
+	namespace uart {
+		uint8_t  mock_baudrate = baud_1M;
+		unsigned mock_baudrate_changes = 0;
+	}
+
+	namespace memory {
+		uint16_t mock_static_size = 0;
+		uint16_t mock_unused = 0;
+		uint16_t mock_stack_peak = 0;
+	}
+
+	namespace timer {
+		uint16_t mock_time = 0;
+	}
+
+	namespace timing     { loop_timing    loop;     }
+	namespace clock_sync { controller     clock;    }
+	namespace trace      { trace_recorder recorder; }
+
+	namespace local_tests { motor_bridge bridge; }
+
+} /* namespace supreme */
@@ -0,0 +1,28 @@
+#ifndef TEST_SUPREME_MOTORDRIVER_HPP
+#define TEST_SUPREME_MOTORDRIVER_HPP
+
+#include <xpcc/architecture/platform.hpp>
+
+/* replaces the motor bridge, records the values last applied */
+
+namespace supreme {
+namespace local_tests {
+
+struct motor_bridge {
+	uint8_t pwm     = 0;
+	bool    dir     = false;
+	bool    enabled = false;
+};
+
+extern motor_bridge bridge; /* see test_globals.cpp */
+
+struct test_motordriver {
+	void set_pwm(uint8_t pwm) { bridge.pwm = pwm; }
+	void set_dir(bool dir)    { bridge.dir = dir; }
+	void enable()             { bridge.enabled = true; }
+	void disable()            { bridge.enabled = false; }
+};
+
+}} /* namespace supreme::local_tests */
+
+#endif /* TEST_SUPREME_MOTORDRIVER_HPP */
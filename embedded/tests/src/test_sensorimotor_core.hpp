@@ -1,3 +1,5 @@
+#include <system/excitation.hpp>
+
 namespace supreme {
 namespace local_tests {
 
@@ -26,18 +28,53 @@ public:
 	void toggle_enable() { enabled = not enabled; }
 	void enable()  { enabled = true; }
 	void disable() { enabled = false; }
+	bool is_enabled() const { return enabled; }
+
+	uint8_t get_pwm_limit() const { return max_pwm; }
+	uint8_t get_target_pwm() const { return voltage_pwm; }
+	bool    get_target_dir() const { return direction; }
+	uint8_t get_faults() { uint8_t f = faults; faults = 0; return f; }
+
+	uint16_t get_watchcat_trips() const { return watchcat_trips; }
+	void     reset_watchcat_trips() { watchcat_trips = 0; }
 
-	uint16_t get_position        () { return 0x1A1B; }
-	uint16_t get_current         () { return 0x2A2B; }
-	uint16_t get_velocity        () { return 0x3A3B; }
-	//uint16_t get_voltage_back_emf() { return 0x0;    } /* currently not in use */
+	void    set_watchcat_timeout(uint8_t t) { watchcat_timeout = t ? t : 10; }
+	uint8_t get_watchcat_timeout() const { return watchcat_timeout; }
+	void    set_stop_mode(uint8_t m) { stop_mode = (m < 4) ? m : 0; }
+	uint8_t get_stop_mode() const { return stop_mode; }
+	void    set_hold_gain(int8_t g) { hold_gain = g; }
+	int8_t  get_hold_gain() const { return hold_gain; }
+	bool    is_stopping() const { return stopping; }
+
+	void start_identification() { identifying = true; enabled = true; }
+	void stop_identification() { if (identifying) { identifying = false; enabled = false; } }
+	bool is_identifying() const { return identifying; }
+	excitation::generator& get_excitation() { return ident; }
+
+	uint16_t get_position        () const { return 0x1A1B; }
+	uint16_t get_current         () const { return 0x2A2B; }
+	uint16_t get_velocity        ()       { return 0x3A3B; }
+	uint16_t get_voltage_back_emf() { return 0x6A6B; } /* not in data response */
 	uint16_t get_voltage_supply  () { return 0x4A4B; }
 	uint16_t get_temperature     () { return 0x5A5B; }
+	uint16_t get_sample_tick     () { return 0x7A7B; }
+
+	void     set_ticks(uint16_t t) { ticks = t; }
+	uint16_t get_ticks() const { return ticks; }
 
 	uint8_t max_pwm = 0;
 	uint8_t voltage_pwm = 0;
 	bool    direction = false;
 	bool    enabled = false;
+	uint8_t faults = 0;
+	uint16_t ticks = 0;
+	uint16_t watchcat_trips = 0;
+	uint8_t  watchcat_timeout = 0;
+	uint8_t  stop_mode = 0;
+	int8_t   hold_gain = 0;
+	bool     stopping = false;
+	bool     identifying = false;
+	excitation::generator ident;
 
 	ExternalSensor sensor_ext;
 };
@@ -0,0 +1,193 @@
+#include <system/communication.hpp>
+#include <xpcc/architecture/platform.hpp>
+#include "./catch_1.10.0.hpp"
+
+#include <test_sensorimotor_core.hpp>
+#include <test_communication.hpp>
+#include <system/trace.hpp>
+
+namespace supreme {
+namespace local_tests {
+
+/* signal source for the trace recorder */
+struct trace_source {
+	uint16_t position = 0;
+	uint16_t current  = 0;
+	uint8_t  pwm      = 0;
+	bool     dir      = true;
+
+	uint16_t get_position()   const { return position; }
+	uint16_t get_current()    const { return current; }
+	uint8_t  get_target_pwm() const { return pwm; }
+	bool     get_target_dir() const { return dir; }
+};
+
+TEST_CASE( "trace recorder captures pre- and post-trigger samples", "[trace]")
+{
+	trace::trace_recorder rec;
+	trace_source src;
+
+	rec.set_channels(trace::position | trace::pwm);
+	REQUIRE( rec.get_capacity() == trace::buffer_words / 2 );
+	rec.set_trigger_mode(trace::rising);
+	rec.set_trigger_channel(0); /* position */
+	rec.set_level(1000);
+	rec.set_pre_trigger(10);
+
+	/* not recording unless armed */
+	rec.record(src);
+	REQUIRE( rec.get_samples() == 0 );
+
+	rec.command(trace::arm);
+	REQUIRE( rec.get_state() == trace::armed );
+
+	/* ramp wraps the ring several times before the trigger */
+	const uint16_t cap = rec.get_capacity();
+	for (uint16_t i = 0; i < 4 * cap; ++i) {
+		src.position = (i < 300) ? 0 : 1000 + i;
+		src.pwm = i & 0xff;
+		src.dir = i & 0x1;
+		rec.record(src);
+	}
+	REQUIRE( rec.get_state() == trace::done );
+	REQUIRE( rec.get_samples() == cap );
+	REQUIRE( rec.get_trigger_pos() == 10 );
+
+	/* oldest sample first: 10 samples before the trigger at i = 300 */
+	for (uint16_t k = 0; k < cap; ++k) {
+		const uint16_t i = 290 + k;
+		const uint16_t pos = (rec.get_byte(4*k  ) << 8) | rec.get_byte(4*k+1);
+		const int16_t  pwm = (rec.get_byte(4*k+2) << 8) | rec.get_byte(4*k+3);
+		REQUIRE( pos == ((i < 300) ? 0 : 1000 + i) );
+		REQUIRE( pwm == ((i & 0x1) ? (i & 0xff) : -(i & 0xff)) );
+	}
+	REQUIRE( rec.get_byte(4*cap) == 0 ); /* beyond the recording */
+
+	/* re-arming while done starts over */
+	rec.command(trace::arm);
+	REQUIRE( rec.get_samples() == 0 );
+	REQUIRE( rec.get_state() == trace::armed );
+}
+
+TEST_CASE( "trace recorder is triggered by command or falling signal, with divider", "[trace]")
+{
+	trace::trace_recorder rec;
+	trace_source src;
+
+	/* velocity is not recorded by default */
+	REQUIRE( rec.get_channels() == (trace::position | trace::current | trace::pwm) );
+	REQUIRE( rec.get_capacity() == trace::buffer_words / 3 );
+
+	rec.set_channels(trace::all_channels);
+	rec.set_divider(4);
+	rec.set_pre_trigger(1000); /* limited to capacity */
+	REQUIRE( rec.get_pre_trigger() == rec.get_capacity() - 1 );
+	rec.set_pre_trigger(2);
+
+	/* manual trigger, only few samples before trigger,
+	   position falling by 7 per cycle */
+	src.position = 30000;
+	rec.command(trace::arm);
+	for (unsigned i = 0; i < 4; ++i) { rec.record(src); src.position -= 7; } /* first cycle recorded at once */
+	REQUIRE( rec.get_samples() == 1 );
+	rec.command(trace::trigger);
+	for (unsigned i = 0; i < 4 * rec.get_capacity(); ++i) { rec.record(src); src.position -= 7; }
+	REQUIRE( rec.get_state() == trace::done );
+	REQUIRE( rec.get_trigger_pos() == 1 );
+
+	/* velocity of one cycle, not of the divider, 0 after arming */
+	REQUIRE( (int16_t) ((rec.get_byte( 4) << 8) | rec.get_byte( 5)) ==  0 );
+	REQUIRE( (int16_t) ((rec.get_byte(12) << 8) | rec.get_byte(13)) == -7 );
+	REQUIRE( ((rec.get_byte(8) << 8) | rec.get_byte(9)) == 30000 - 4 * 7 );
+
+	/* velocity falling through zero, signed compare */
+	rec.set_divider(1);
+	rec.set_trigger_mode(trace::falling);
+	rec.set_trigger_channel(2);
+	rec.set_level(0);
+	rec.command(trace::arm);
+	for (unsigned i = 0; i < 20; ++i) { src.position += 5; rec.record(src); }
+	REQUIRE( rec.get_state() == trace::armed );
+	src.position -= 3;
+	rec.record(src);
+	REQUIRE( rec.get_state() == trace::triggered );
+	REQUIRE( rec.get_trigger_pos() == 2 );
+
+	/* stopping keeps the recording */
+	rec.command(trace::stop);
+	REQUIRE( rec.get_state() == trace::stopped );
+	REQUIRE( rec.get_samples() == 21 );
+	rec.record(src);
+	REQUIRE( rec.get_samples() == 21 );
+}
+
+TEST_CASE( "trace is configured by registers and downloaded in chunks", "[trace]")
+{
+	reset_hardware();
+	set_motor_id(23);
+
+	using core_t = test_sensorimotor_core;
+	using exts_t = ExternalSensor;
+	core_t ux;
+	exts_t ex;
+	supreme::communication_ctrl<core_t, exts_t> com(ux, ex);
+
+	REQUIRE( (capabilities::features & capabilities::trace) != 0 );
+
+	/* current only, arm, trigger by command */
+	send({ 0x60, 23, /*addr=*/0xC1, /*len=*/1, trace::current });
+	com.step();
+	send({ 0x60, 23, /*addr=*/0xC0, /*len=*/1, trace::arm });
+	com.step();
+	REQUIRE( trace::recorder.get_state() == trace::armed );
+	send({ 0x60, 23, /*addr=*/0xC0, /*len=*/1, trace::trigger });
+	com.step();
+	for (unsigned i = 0; i < trace::buffer_words; ++i)
+		trace::recorder.record(ux);
+	REQUIRE( trace::recorder.get_state() == trace::done );
+
+	Uart0::recv_buffer.clear();
+	send({ 0x50, 23, /*addr=*/0xC0, /*len=*/16 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 16 + 1 );
+	REQUIRE( Uart0::recv_buffer[5] == trace::done );
+	REQUIRE( Uart0::recv_buffer[6] == trace::current );
+	REQUIRE( get_signed_word(Uart0::recv_buffer[15], Uart0::recv_buffer[16]) == (int) trace::buffer_words ); /* samples */
+	REQUIRE( get_signed_word(Uart0::recv_buffer[19], Uart0::recv_buffer[20]) == (int) trace::buffer_words ); /* capacity */
+
+	/* chunk at the end of the recording, padded with zeros */
+	Uart0::recv_buffer.clear();
+	const uint16_t offset = 2 * trace::buffer_words - 4;
+	send({ 0x58, 23, (uint8_t) (offset >> 8), (uint8_t) offset, /*len=*/8 });
+	com.step();
+	REQUIRE( com.get_errors() == 0 );
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 3 + 8 + 1 );
+	REQUIRE( Uart0::recv_buffer[2] == 0x59 );
+	REQUIRE( Uart0::recv_buffer[3] == 23 );
+	REQUIRE( Uart0::recv_buffer[4] == 8 );
+	REQUIRE( Uart0::recv_buffer[5] == 0x2A );
+	REQUIRE( Uart0::recv_buffer[6] == 0x2B );
+	REQUIRE( Uart0::recv_buffer[7] == 0x2A );
+	REQUIRE( Uart0::recv_buffer[8] == 0x2B );
+	for (unsigned i = 9; i < 13; ++i)
+		REQUIRE( Uart0::recv_buffer[i] == 0 );
+	REQUIRE( verify_checksum(Uart0::recv_buffer) );
+
+	/* chunk too long */
+	Uart0::recv_buffer.clear();
+	send({ 0x58, 23, 0, 0, defaults::max_trace_chunk + 1 });
+	com.step();
+	REQUIRE( com.get_errors() == 1 );
+	REQUIRE( Uart0::recv_buffer.size() == 0 );
+
+	/* requests to other motors are skipped */
+	send({ 0x58, 42, 0, 0, 4 });
+	send({ 0xE0, 23 });
+	com.step();
+	REQUIRE( Uart0::recv_buffer.size() == 2 + 2 + 1 );
+	REQUIRE( Uart0::recv_buffer[2] == 0xE1 );
+
+	trace::recorder.set_channels(trace::default_channels);
+}
+
+}} /* namespace supreme::local_tests */